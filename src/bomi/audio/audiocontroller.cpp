@@ -11,6 +11,7 @@
 #include "enum/channellayout.hpp"
 #include "misc/log.hpp"
 #include "misc/speedmeasure.hpp"
+#include "misc/trace.hpp"
 extern "C" {
 #include <audio/filter/af.h>
 }
@@ -257,6 +258,7 @@ auto AudioController::control(int cmd, void *arg) -> int
 
 auto AudioController::filter(mp_audio *data) -> int
 {
+    TraceScope trace("af filter", data ? data->samples : 0);
     if (d->dirty) {
         d->mutex.lock();
         if (d->dirty & Normalizer) {
@@ -288,6 +290,7 @@ auto AudioController::filter(mp_audio *data) -> int
 
 auto AudioController::output() -> int
 {
+    TraceScope trace("af output");
     if (d->input) {
         auto buffer = d->resampler.run(d->input);
         d->input = AudioBufferPtr();
@@ -31,6 +31,8 @@ QMAKE_CXXFLAGS += -Wno-non-template-friend
 }
 
 !isEmpty(USE_CCACHE): QMAKE_CXX = ccache $${QMAKE_CXX}
+# e.g. LOG_LEVEL=4 strips _Debug() and _Trace() at compile time
+!isEmpty(LOG_LEVEL): DEFINES += BOMI_LOG_LEVEL=$${LOG_LEVEL}
 
 macx {
     QT += macextras
@@ -93,8 +95,13 @@ HEADERS += \
 	subtitle/richtexthelper.hpp \
 	subtitle/richtextblock.hpp \
 	subtitle/richtextdocument.hpp \
+	subtitle/richtextlayoutcache.hpp \
 	subtitle/subtitledrawer.hpp \
 	subtitle/subtitlerenderingthread.hpp \
+	subtitle/subcompimagecache.hpp \
+	subtitle/shadoweffect.hpp \
+	subtitle/subtitleglyphatlas.hpp \
+	subtitle/subtitleglyphrenderer.hpp \
 	subtitle/opensubtitlesfinder.hpp \
 	quick/busyiconitem.hpp \
 	quick/toplevelitem.hpp \
@@ -193,7 +200,10 @@ HEADERS += \
 	player/mpv_helper.hpp \
 	player/playengine_p.hpp \
 	player/historymodel.hpp \
+	player/historywriter.hpp \
+	player/historysearch.hpp \
 	player/playlistmodel.hpp \
+	player/playlistreader.hpp \
     audio/channellayoutmap.hpp \
     player/openmediainfo.hpp \
     enum/openmediabehavior.hpp \
@@ -203,6 +213,7 @@ HEADERS += \
     opengl/opengllogger.hpp \
     enum/enumflags.hpp \
     misc/is_convertible.hpp \
+    misc/jsonbinary.hpp \
     misc/jsonstorage.hpp \
     player/mrlstatesqlfield.hpp \
     tmp/algorithm.hpp \
@@ -222,6 +233,9 @@ HEADERS += \
 	player/avinfoobject.hpp \
     audio/audioformat.hpp \
     player/streamtrack.hpp \
+    misc/collation.hpp \
+    misc/dirscanner.hpp \
+    misc/parallel.hpp \
     misc/locale.hpp \
     misc/matchstring.hpp \
     misc/simplelistdelegate.hpp \
@@ -262,6 +276,7 @@ HEADERS += \
     widget/pathbutton.hpp \
 	misc/logoption.hpp \
     misc/logviewer.hpp \
+    misc/trace.hpp \
 	tmp/type_traits.hpp \
     os/os.hpp \
     os/x11.hpp \
@@ -285,6 +300,7 @@ HEADERS += \
     json/jrclient.hpp \
     json/jrcommon.hpp \
 	json/jriface.hpp \
+    json/jrsubscription.hpp \
     player/jrplayer.hpp \
     enum/jrprotocol.hpp \
     enum/jrconnection.hpp \
@@ -324,8 +340,13 @@ SOURCES += \
 	subtitle/richtexthelper.cpp \
 	subtitle/richtextblock.cpp \
 	subtitle/richtextdocument.cpp \
+	subtitle/richtextlayoutcache.cpp \
 	subtitle/subtitledrawer.cpp \
 	subtitle/subtitlerenderingthread.cpp \
+	subtitle/subcompimagecache.cpp \
+	subtitle/shadoweffect.cpp \
+	subtitle/subtitleglyphatlas.cpp \
+	subtitle/subtitleglyphrenderer.cpp \
 	subtitle/opensubtitlesfinder.cpp \
 	quick/geometryitem.cpp \
 	quick/busyiconitem.cpp \
@@ -413,6 +434,7 @@ SOURCES += \
 	pref/pref.cpp \
 	player/playlist.cpp \
 	player/playlistmodel.cpp \
+	player/playlistreader.cpp \
 	player/recentinfo.cpp \
 	player/appstate.cpp \
 	player/rootmenu.cpp \
@@ -422,6 +444,8 @@ SOURCES += \
 	player/mediamisc.cpp \
 	player/mrlstate.cpp \
 	player/historymodel.cpp \
+	player/historywriter.cpp \
+	player/historysearch.cpp \
 	player/mpv_helper.cpp \
     audio/channellayoutmap.cpp \
     player/openmediainfo.cpp \
@@ -430,6 +454,7 @@ SOURCES += \
     misc/stepactionpair.cpp \
     opengl/opengltexturetransferinfo.cpp \
     opengl/opengllogger.cpp \
+    misc/jsonbinary.cpp \
     misc/jsonstorage.cpp \
     player/mrlstatesqlfield.cpp \
     misc/localconnection.cpp \
@@ -448,6 +473,8 @@ SOURCES += \
 	player/avinfoobject.cpp \
     audio/audioformat.cpp \
     player/streamtrack.cpp \
+    misc/collation.cpp \
+    misc/dirscanner.cpp \
     misc/locale.cpp \
     misc/matchstring.cpp \
     misc/simplelistdelegate.cpp \
@@ -483,6 +510,7 @@ SOURCES += \
     widget/pathbutton.cpp \
 	misc/logoption.cpp \
 	misc/logviewer.cpp \
+    misc/trace.cpp \
     os/x11.cpp \
     os/os.cpp \
     enum/codecid.cpp \
@@ -503,6 +531,7 @@ SOURCES += \
     json/jrclient.cpp \
     json/jrcommon.cpp \
 	json/jriface.cpp \
+    json/jrsubscription.cpp \
     player/jrplayer.cpp \
     enum/jrprotocol.cpp \
     enum/jrconnection.cpp \
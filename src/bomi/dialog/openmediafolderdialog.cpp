@@ -2,9 +2,9 @@
 #include "ui_openmediafolderdialog.h"
 #include "player/playlist.hpp"
 #include "misc/objectstorage.hpp"
+#include "misc/collation.hpp"
+#include "misc/dirscanner.hpp"
 #include <QFileIconProvider>
-#include <QCollator>
-#include "tmp/algorithm.hpp"
 
 enum ListRole {
     Type = Qt::UserRole + 1, Path
@@ -14,6 +14,7 @@ struct OpenMediaFolderDialog::Data {
     OpenMediaFolderDialog *p = nullptr;
     Ui::OpenMediaFolderDialog ui;
     bool generating = false;
+    QPointer<DirScan> scan;
     QFileIconProvider icons;
     ObjectStorage storage;
 
@@ -40,26 +41,16 @@ struct OpenMediaFolderDialog::Data {
     }
 
 
-    static auto sort(QFileInfoList &list) -> QFileInfoList&
+    auto add(const DirListing &dir, const QString &root) -> void
     {
-        QCollator c;
-        c.setNumericMode(true);
-        tmp::sort(list, [&](auto &lhs, auto &rhs)
-            { return c.compare(lhs.fileName(), rhs.fileName()) < 0; });
-        return list;
-    }
-
-    auto open(const QDir &dir, const QString &root, bool recursive) -> void
-    {
-        static const auto filters = _ToNameFilter(MediaExt);
-        auto files = dir.entryInfoList(filters, QDir::Files);
-        sort(files);
-        for (int i=0; i<files.size(); ++i) {
-            const auto path = files[i].absoluteFilePath();
+        auto files = dir.filter(MediaExt);
+        _CollatedSort(files, [] (const QString &name) { return name; });
+        for (auto &name : files) {
+            const auto path = dir.filePath(name);
             auto item = new QListWidgetItem(path.mid(root.size() + 1), ui.list);
             QCheckBox *box = nullptr;
             item->setCheckState(Qt::Unchecked);
-            const QString suffix = files[i].suffix();
+            const QString suffix = name.mid(name.lastIndexOf('.'_q) + 1);
             if (_IsSuffixOf(VideoExt, suffix))
                 box = ui.videos;
             else if (_IsSuffixOf(AudioExt, suffix))
@@ -67,26 +58,44 @@ struct OpenMediaFolderDialog::Data {
             else if (_IsSuffixOf(ImageExt, suffix))
                 box = ui.images;
             Q_ASSERT(box);
-            item->setIcon(icons.icon(files[i]));
+            item->setIcon(icons.icon(QFileInfo(path)));
             item->setData(Type, QVariant::fromValue(box));
             item->setData(Path, path);
             item->setCheckState(box->isChecked() ? Qt::Checked : Qt::Unchecked);
         }
-        if (recursive) {
-            auto subs = dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
-            sort(subs);
-            for (auto &sub : subs)
-                open(QDir(sub.absoluteFilePath()), root, recursive);
-        }
+    }
+
+    auto cancel() -> void
+    {
+        if (scan)
+            scan->cancel();
+        scan = nullptr;
+        generating = false;
     }
 
     auto updateList() -> void
     {
+        cancel();
         ui.list->clear();
         const auto folder = ui.folder->text();
         if (!folder.isEmpty()) {
-            const QDir dir(folder);
-            open(dir, dir.absolutePath(), ui.recursive->isChecked());
+            const auto root = QDir(folder).absolutePath();
+            generating = true;
+            ui.dbb->button(QDialogButtonBox::Open)->setEnabled(false);
+            scan = DirScanner::instance().scan(root, ui.recursive->isChecked());
+            auto current = scan.data();
+            connect(current, &DirScan::listed, p, [=] (const DirListing &dir) {
+                if (scan == current)
+                    add(dir, root);
+            });
+            connect(current, &DirScan::finished, p, [=] () {
+                if (scan != current)
+                    return;
+                scan = nullptr;
+                generating = false;
+                updateOpenButton();
+            });
+            scan->start();
         }
         updateOpenButton();
     }
@@ -125,6 +134,7 @@ OpenMediaFolderDialog::OpenMediaFolderDialog(QWidget *parent, const QString &key
 }
 
 OpenMediaFolderDialog::~OpenMediaFolderDialog() {
+    d->cancel();
     d->storage.save();
     delete d;
 }
@@ -3,21 +3,92 @@
 #include "http-parser/http_parser.h"
 #include "misc/log.hpp"
 #include <QNetworkRequest>
+#include <QUrlQuery>
+#include <QQueue>
 
 DECLARE_LOG_CONTEXT(JSON-RPC)
 
+// reading stops above high-water mark of unsent bytes and resumes below
+// low-water mark, so slow client is throttled by flow control of socket
+static constexpr qint64 HighWater = 1024 * 1024, LowWater = 64 * 1024;
+static constexpr qint64 ReadChunk = 64 * 1024;
+// reading also stops while this many messages wait for replies and
+// resumes at half, so a fast client cannot flood the thread of server
+static constexpr int MaxInFlight = 64;
+// persistent HTTP connection without request is closed after this in ms
+static constexpr int IdleTimeout = 30000;
+// larger body is rejected
+static constexpr int MaxBodySize = 16 * 1024 * 1024;
+// initial and maximum size of buffer for raw stream of a client
+static constexpr qint64 InitialRing = 64 * 1024, MaxBuffered = 16 * 1024 * 1024;
+
 struct JrClient::Data {
+    JrClient *p = nullptr;
+    int id = 0;
     QIODevice *device;
     JrServer *server;
     QString peer;
+    bool paused = false, reading = false;
+    // messages dispatched but not replied yet
+    int inFlight = 0;
+    // latest notification of each subscription held while congested
+    QMap<int, QJsonValue> pending;
+    auto congested() -> bool
+    {
+        if (!paused && (device->bytesToWrite() > HighWater || inFlight >= MaxInFlight))
+            paused = true;
+        return paused;
+    }
+    auto read() -> void
+    {
+        // reply can be written synchronously while reading
+        if (reading)
+            return;
+        reading = true;
+        p->read();
+        reading = false;
+    }
+    auto resume() -> void
+    {
+        if (!paused || device->bytesToWrite() > LowWater || inFlight > MaxInFlight / 2)
+            return;
+        paused = false;
+        read();
+        notify();
+    }
+    auto notify() -> void
+    {
+        if (pending.isEmpty())
+            return;
+        if (device->bytesToWrite() > HighWater) {
+            paused = true;
+            return;
+        }
+        QJsonArray batch;
+        for (auto &json : pending)
+            batch.push_back(json);
+        pending.clear();
+        if (batch.size() == 1)
+            p->send(QJsonDocument(batch.first().toObject()));
+        else
+            p->send(QJsonDocument(batch));
+    }
 };
 
 JrClient::JrClient(QIODevice *device, const QString &peer, JrServer *server)
-    : QObject(server), d(new Data)
+    : QObject(device), d(new Data)
 {
+    static QAtomicInt lastId;
+    d->p = this;
+    d->id = lastId.fetchAndAddRelaxed(1) + 1;
     d->device = device;
     d->server = server;
     d->peer = peer;
+    connect(device, &QIODevice::readyRead, this, [=] () {
+        if (!d->congested())
+            d->read();
+    });
+    connect(device, &QIODevice::bytesWritten, this, [=] () { d->resume(); });
 }
 
 JrClient::~JrClient()
@@ -25,6 +96,11 @@ JrClient::~JrClient()
     delete d;
 }
 
+auto JrClient::id() const -> int
+{
+    return d->id;
+}
+
 auto JrClient::peer() const -> QString
 {
     return d->peer;
@@ -32,33 +108,73 @@ auto JrClient::peer() const -> QString
 
 auto JrClient::reply(const JrResponse &response) -> void
 {
+    QElapsedTimer timer;
+    timer.start();
     write({ response }, QJsonDocument(response.toJson()));
+    d->server->record(JrServer::Write, timer.nsecsElapsed());
 }
 
 auto JrClient::reply(const QList<JrResponse> &responses) -> void
 {
+    QElapsedTimer timer;
+    timer.start();
     QJsonArray array;
     for (auto &res : responses)
         array.push_back(res.toJson());
     write(responses, QJsonDocument(array));
+    d->server->record(JrServer::Write, timer.nsecsElapsed());
 }
 
 auto JrClient::write(const QList<JrResponse> &responses,
                      const QJsonDocument &doc) -> void
 {
+    if (d->inFlight > 0)
+        --d->inFlight;
+    if (!d->device->isOpen())
+        return;
     const auto data = doc.toJson(QJsonDocument::Compact);
     beginReply(responses, data.size() + 1);
     *d->device << data << '\n';
     endReply();
     if (autoClose())
         d->device->close();
+    else
+        d->resume();
+}
+
+auto JrClient::send(const QJsonDocument &doc) -> void
+{
+    if (d->device->isWritable())
+        *d->device << doc.toJson(QJsonDocument::Compact) << '\n';
+}
+
+auto JrClient::notify(const QJsonArray &notifications) -> void
+{
+    for (auto json : notifications) {
+        const auto params = json.toObject()[u"params"_q].toObject();
+        d->pending[params[u"subscription"_q].toInt()] = json;
+    }
+    d->notify();
 }
 
 auto JrClient::parse(const QByteArray &data) -> void
 {
+    // every message gets exactly one reply
+    ++d->inFlight;
     d->server->parse(this, data);
 }
 
+auto JrClient::process(const QJsonDocument &doc) -> void
+{
+    ++d->inFlight;
+    d->server->process(this, doc);
+}
+
+auto JrClient::isCongested() const -> bool
+{
+    return d->congested();
+}
+
 auto JrClient::device() const -> QIODevice*
 {
     return d->device;
@@ -78,8 +194,14 @@ struct JrHttp::Data {
     http_parser *parser = nullptr;
     http_parser_settings settings;
     Request request;
+    // body keeps its capacity over requests of connection
     QByteArray field, value, body;
     QString url;
+    // keepAlive of parsed request, replying is of request being replied
+    // and replies come in the order of requests
+    bool keepAlive = true, replying = true, closing = false;
+    QQueue<bool> keepAlives;
+    QTimer idle;
     auto fillHeader() -> void
     {
         if (field.isEmpty() || value.isEmpty())
@@ -101,7 +223,7 @@ struct JrHttp::Data {
     }
     auto close(JrHttp::Status status) -> void
     {
-        writeStatus(status) << "\r\n";
+        writeStatus(status) << "Content-Length: 0\r\nConnection: close\r\n\r\n";
         p->device()->close();
     }
     auto writeStatus(JrHttp::Status status) -> QIODevice&
@@ -109,6 +231,27 @@ struct JrHttp::Data {
         return *p->device() << "HTTP/1.1 " << QByteArray::number(status)
                             << " " << text(status) << "\r\n";
     }
+    // query string of GET request to JSON-RPC request
+    auto fromQuery() const -> QJsonDocument
+    {
+        QJsonObject json;
+        json[u"jsonrpc"_q] = u"2.0"_q;
+        const QUrlQuery query(QUrl(url).query());
+        for (auto &item : query.queryItems(QUrl::FullyDecoded)) {
+            if (item.first == "params"_a) {
+                const auto base64 = QByteArray::fromBase64(item.second.toLatin1());
+                const auto doc = QJsonDocument::fromJson(base64);
+                if (doc.isArray())
+                    json[item.first] = doc.array();
+                else if (doc.isObject())
+                    json[item.first] = doc.object();
+                else
+                    json[item.first] = QJsonValue::Null;
+            } else
+                json[item.first] = item.second;
+        }
+        return QJsonDocument(json);
+    }
 };
 
 JrHttp::JrHttp(QIODevice *device, const QString &peer, JrServer *server)
@@ -123,15 +266,18 @@ JrHttp::JrHttp(QIODevice *device, const QString &peer, JrServer *server)
 #define GET_DATA() static_cast<Data*>(parser->data)
     d->settings.on_message_begin = [] (http_parser *parser) -> int {
         auto d = GET_DATA();
+        // rest of pipeline is dropped after closing
+        if (d->closing || !d->p->device()->isOpen())
+            return -1;
         d->field.clear();
         d->value.clear();
         d->request = Request();
-        d->body.clear();
+        d->body.resize(0);
         d->url.clear();
         return 0;
     };
     d->settings.on_url = [] (http_parser *parser, const char *at, size_t len) -> int
-        { GET_DATA()->url = QString::fromLatin1(at, len); return 0; };
+        { GET_DATA()->url += QLatin1String(at, len); return 0; };
     d->settings.on_header_field = [] (http_parser *parser, const char *at, size_t len) -> int
         { auto d = GET_DATA(); d->fillHeader(); d->field.append(at, len); return 0; };
     d->settings.on_header_value = [] (http_parser *parser, const char *at, size_t len) -> int
@@ -140,6 +286,7 @@ JrHttp::JrHttp(QIODevice *device, const QString &peer, JrServer *server)
     {
         auto d = GET_DATA();
         d->fillHeader();
+        d->keepAlive = http_should_keep_alive(parser);
 
         switch (parser->method) {
         case HTTP_POST:
@@ -160,54 +307,36 @@ JrHttp::JrHttp(QIODevice *device, const QString &peer, JrServer *server)
             "application/json",
             "application/jsonrequest"
         };
-        if (len <= 0 || !types.contains(type) || !types.contains(accept)) {
+        if (len <= 0 || len > MaxBodySize || !types.contains(type) || !types.contains(accept)) {
             d->close(BadRequest);
             _Error("Bad Request: content-type: %%, content-length: %%, accept: %%", type, len, accept);
             return -1;
         }
+        if (d->body.capacity() < len)
+            d->body.reserve(len);
         return 0;
     };
     d->settings.on_body = [] (http_parser *parser, const char *at, size_t len) -> int
         { GET_DATA()->body.append(at, len); return 0; };
     d->settings.on_message_complete = [] (http_parser *parser) -> int {
         auto d = GET_DATA();
-        if (parser->method == HTTP_GET) {
-            QRegEx rx(uR"((\?|&)([^=]+)=([^&]+))"_q);
-            int pos = 0;
-            d->body.clear();
-            d->body += "{\"jsonrpc\":\"2.0\"";
-            while (pos < d->url.size()) {
-                const auto m = rx.match(d->url, pos);
-                if (!m.hasMatch())
-                    break;
-                if (d->body.at(d->body.size() - 1) != ',')
-                    d->body += ',';
-                const auto key = m.capturedRef(2).toLatin1();
-                const auto value = m.capturedRef(3).toLatin1();
-                if (key == "jsonrpc"_b)
-                    d->body.replace("{\"jsonrpc\":\"2.0\"", "{\"jsonrpc\":\"" + value + "\"");
-                else {
-                    d->body += '"' + key + "\":";
-                    if (key == "params"_b) {
-                        const auto base64 = QByteArray::fromPercentEncoding(value);
-                        d->body += QByteArray::fromBase64(base64);
-                    } else
-                        d->body += '"' + value + '"';
-                }
-                pos = m.capturedEnd();
-                if (pos < 0)
-                    break;
-            }
-            d->body += '}';
-        }
-        d->p->parse(d->body);
+        // before processing, because reply may be written synchronously
+        d->keepAlives.enqueue(d->keepAlive);
+        d->closing = !d->keepAlive;
+        if (parser->method == HTTP_GET)
+            d->p->process(d->fromQuery());
+        else
+            d->p->parse(d->body);
         return 0;
     };
 #undef GET_DATA
-    connect(device, &QIODevice::readyRead, this, [=] () {
-        const auto data = this->device()->readAll();
-        http_parser_execute(d->parser, &d->settings, data.data(), data.size());
+    d->idle.setSingleShot(true);
+    d->idle.setInterval(IdleTimeout);
+    connect(&d->idle, &QTimer::timeout, this, [=] () {
+        _Debug("Close idle connection: %%", this->peer());
+        this->device()->close();
     });
+    d->idle.start();
 }
 
 JrHttp::~JrHttp()
@@ -216,6 +345,31 @@ JrHttp::~JrHttp()
     delete d;
 }
 
+auto JrHttp::autoClose() const -> bool
+{
+    return !d->replying;
+}
+
+auto JrHttp::read() -> void
+{
+    d->idle.start();
+    // pipelined requests are replied in order as they are parsed
+    while (device()->isOpen() && !d->closing
+           && device()->bytesAvailable() > 0 && !isCongested()) {
+        const auto data = device()->read(ReadChunk);
+        const auto len = http_parser_execute(d->parser, &d->settings, data.data(), data.size());
+        if (HTTP_PARSER_ERRNO(d->parser) != HPE_OK || len != (size_t)data.size()) {
+            // requests after 'Connection: close' are ignored
+            if (device()->isOpen() && !d->closing) {
+                _Error("Cannot parse HTTP request: %%",
+                       http_errno_description(HTTP_PARSER_ERRNO(d->parser)));
+                d->close(BadRequest);
+            }
+            return;
+        }
+    }
+}
+
 auto JrHttp::beginReply(const QList<JrResponse> &responses, int length) -> void
 {
     Status status = Ok;
@@ -236,83 +390,150 @@ auto JrHttp::beginReply(const QList<JrResponse> &responses, int length) -> void
         if (status != Ok)
             break;
     }
+    d->idle.start();
+    d->replying = d->keepAlives.isEmpty() ? d->keepAlive : d->keepAlives.dequeue();
     d->writeStatus(status) << "Content-Type: application/json-rpc\r\n"
-                           << "Content-Length: " << length << "\r\n\r\n";
+                           << "Content-Length: " << length << "\r\n"
+                           << "Connection: " << (d->replying ? "keep-alive"_b : "close"_b)
+                           << "\r\n\r\n";
 }
 
 /******************************************************************************/
 
+// received bytes are kept in a ring whose capacity is a power of 2
+// positions are absolute and wrap around by mask
 struct JrRaw::Data {
-    QByteArray data;
+    // Json: bracketed JSON text, so newline-delimited or concatenated
+    // Length: decimal length followed by ':' or newline, then Payload
+    enum Frame { None, Json, Length, Payload };
+    QByteArray ring;
+    qint64 head = 0, tail = 0, pos = 0, begin = 0, length = 0;
+    Frame frame = None;
     char bracket_l = 0, bracket_r = 0;
-    int last = 0, open = 0, begin = -1;
-    bool inString = false;
-    auto extract() -> QByteArray
+    int open = 0;
+    bool inString = false, escaped = false;
+    auto mask() const -> qint64 { return ring.size() - 1; }
+    auto at(qint64 i) const -> char { return ring.at(i & mask()); }
+    auto size() const -> qint64 { return tail - head; }
+    auto copy(char *dst, qint64 from, qint64 len) const -> void
     {
-        const char* at = data.constData() + last;
-        const char* end = at + data.size();
-        if (begin < 0) {
-            Q_ASSERT(!open);
-            Q_ASSERT(!bracket_l);
-            Q_ASSERT(!bracket_r);
-            Q_ASSERT(!inString);
-            while (at < end) {
-                if (*at == '{') {
-                    bracket_l = '{';
-                    bracket_r = '}';
-                    break;
-                }
-                if(*at == '[') {
-                    bracket_l = '[';
-                    bracket_r = ']';
-                    break;
-                }
-                ++at;
-            }
-            if (at >= end) {
-                data.clear();
-                last = 0;
-                return QByteArray();
-            }
-            Q_ASSERT(bracket_l && bracket_r);
-            open = 1;
-            begin = at - data.constData();
-            ++at;
+        if (len <= 0)
+            return;
+        const auto i = from & mask();
+        const auto first = qMin(len, ring.size() - i);
+        memcpy(dst, ring.constData() + i, first);
+        memcpy(dst + first, ring.constData(), len - first);
+    }
+    // makes room for free bytes, false if it exceeds the limit
+    auto reserve(qint64 free) -> bool
+    {
+        if (ring.size() - size() >= free)
+            return true;
+        qint64 capacity = qMax<qint64>(ring.size(), InitialRing);
+        while (capacity - size() < free)
+            capacity *= 2;
+        if (capacity > MaxBuffered)
+            return false;
+        QByteArray buffer(capacity, Qt::Uninitialized);
+        copy(buffer.data(), head, size());
+        tail -= head; pos -= head; begin -= head; head = 0;
+        ring.swap(buffer);
+        return true;
+    }
+    // reads into free space of ring directly
+    auto fill(QIODevice *device, qint64 len) -> qint64
+    {
+        qint64 total = 0;
+        while (total < len) {
+            const auto i = tail & mask();
+            const auto contiguous = qMin(len - total, ring.size() - i);
+            const auto read = device->read(ring.data() + i, contiguous);
+            if (read <= 0)
+                break;
+            tail += read;
+            total += read;
         }
-
-        while (open > 0 && at < end) {
-            if (*at == '\\')
-                ++at;
-            else if (*at == '"')
-                inString = !inString;
-            else if (!inString) {
-                if (*at == bracket_l)
-                    ++open;
-                else if (*at == bracket_r)
-                    --open;
-            }
-            ++at;
+        return total;
+    }
+    // contiguous message refers to ring without copy until next fill()
+    auto take(QByteArray &message) -> int
+    {
+        const auto len = pos - begin;
+        const auto i = begin & mask();
+        if (i + len <= ring.size())
+            message = QByteArray::fromRawData(ring.constData() + i, len);
+        else {
+            message.resize(len);
+            copy(message.data(), begin, len);
         }
-
-        const auto pos = at - data.constData();
-        if (!open) { // found
-            Q_ASSERT(!inString);
-            Q_ASSERT(begin >= 0);
-            auto ret = data.mid(begin, pos - begin);
-            data = data.mid(pos);
-            last = bracket_l = bracket_r = 0;
-            begin = -1;
-            return ret;
+        head = pos;
+        frame = None;
+        return 1;
+    }
+    // 1 if message found, 0 if more data required, -1 for malformed frame
+    // every byte is visited only once
+    auto next(QByteArray &message) -> int
+    {
+        while (pos < tail || frame == Payload) {
+            if (frame == Payload) {
+                if (tail - begin < length)
+                    return 0;
+                pos = begin + length;
+                return take(message);
+            }
+            if (frame == Json) {
+                for (; pos < tail; ++pos) {
+                    const char c = at(pos);
+                    if (escaped)
+                        escaped = false;
+                    else if (inString) {
+                        if (c == '\\')
+                            escaped = true;
+                        else if (c == '"')
+                            inString = false;
+                    } else if (c == '"')
+                        inString = true;
+                    else if (c == bracket_l)
+                        ++open;
+                    else if (c == bracket_r && !--open) {
+                        ++pos;
+                        return take(message);
+                    }
+                }
+                return 0;
+            }
+            const char c = at(pos++);
+            const bool digit = '0' <= c && c <= '9';
+            if (frame == Length) {
+                if (digit) {
+                    length = length * 10 + (c - '0');
+                    if (length > MaxBuffered)
+                        return -1;
+                } else if (c == ':' || c == '\n') {
+                    frame = Payload;
+                    head = begin = pos;
+                } else if (c != '\r')
+                    return -1;
+            } else if (c == '{' || c == '[') {
+                frame = Json;
+                begin = pos - 1;
+                open = 1;
+                inString = escaped = false;
+                bracket_l = c;
+                bracket_r = c == '{' ? '}' : ']';
+            } else if (digit) {
+                frame = Length;
+                length = c - '0';
+            } else
+                head = pos; // whitespace or garbage between messages
         }
-        last = pos;
-        return QByteArray();
+        return 0;
     }
 };
 
 JrRaw::JrRaw(QIODevice *device, const QString &peer, JrServer *server)
     : JrClient(device, peer, server), d(new Data)
 {
-    connect(device, &QIODevice::readyRead, this, &JrRaw::read);
 }
 
 JrRaw::~JrRaw()
@@ -323,11 +544,26 @@ JrRaw::~JrRaw()
 auto JrRaw::read() -> void
 {
     Q_ASSERT(device());
-    d->data.append(device()->readAll());
-    while (!d->data.isEmpty()) {
-        auto data = d->extract();
-        if (data.isEmpty())
-            return; // fetch more
-        parse(data);
+    while (device()->bytesAvailable() > 0 && !isCongested()) {
+        const auto len = qMin(device()->bytesAvailable(), ReadChunk);
+        if (!d->reserve(len)) {
+            _Error("Too much data buffered from %%.", peer());
+            device()->close();
+            return;
+        }
+        if (d->fill(device(), len) <= 0)
+            return;
+        QByteArray message;
+        int found = 0;
+        while ((found = d->next(message)) > 0) {
+            parse(message);
+            if (!device()->isOpen())
+                return;
+        }
+        if (found < 0) {
+            _Error("Malformed frame from %%.", peer());
+            device()->close();
+            return;
+        }
     }
 }
@@ -9,19 +9,33 @@ class JrClient : public QObject {
 public:
     JrClient(QIODevice *device, const QString &peer, JrServer *server);
     ~JrClient();
+    // unique in process
+    auto id() const -> int;
     auto peer() const -> QString;
     auto device() const -> QIODevice*;
     auto server() const -> JrServer*;
     auto parse(const QByteArray &data) -> void;
+    auto process(const QJsonDocument &doc) -> void;
+    // close after reply
     virtual auto autoClose() const -> bool { return false; }
+    // can send notifications without request
+    virtual auto canNotify() const -> bool { return true; }
+    // reading is paused while unsent data exceeds high-water mark
+    // or too many messages are waiting for replies
+    auto isCongested() const -> bool;
     auto reply(const JrResponse &response) -> void;
     auto reply(const QList<JrResponse> &response) -> void;
+    // sends notifications in a batch, coalesced by subscription while congested
+    auto notify(const QJsonArray &notifications) -> void;
 protected:
+    // reads available data of device unless congested
+    virtual auto read() -> void { }
     virtual auto beginReply(const QList<JrResponse> &/*responses*/, int /*length*/) -> void { }
     virtual auto endReply() -> void { }
 private:
     auto write(const QList<JrResponse> &responses,
                const QJsonDocument &doc) -> void;
+    auto send(const QJsonDocument &doc) -> void;
     struct Data;
     Data *d;
 };
@@ -38,8 +52,10 @@ public:
     JrHttp(QIODevice *device, const QString &peer, JrServer *server);
     ~JrHttp();
     auto beginReply(const QList<JrResponse> &responses, int length) -> void final;
-    auto autoClose() const -> bool final { return true; }
+    auto autoClose() const -> bool final;
+    auto canNotify() const -> bool final { return false; }
 private:
+    auto read() -> void final;
     struct Data;
     Data *d;
 };
@@ -49,7 +65,7 @@ public:
     JrRaw(QIODevice *device, const QString &peer, JrServer *server);
     ~JrRaw();
 private:
-    auto read() -> void;
+    auto read() -> void final;
     struct Data;
     Data *d;
 };
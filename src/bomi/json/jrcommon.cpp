@@ -13,6 +13,15 @@ auto JrRequest::fromJson(const QJsonObject &json) -> JrRequest
     return jr;
 }
 
+auto JrRequest::fromMethod(const QString &method, const QJsonValue &id) -> JrRequest
+{
+    JrRequest jr;
+    jr.m_version = u"2.0"_q;
+    jr.m_method = method;
+    jr.m_id = id;
+    return jr;
+}
+
 auto JrRequest::isValid() const -> bool
 {
     return m_version == "2.0"_a && !m_method.isEmpty()
@@ -11,6 +11,8 @@ public:
     auto isNotification() const -> bool { return m_id.isUndefined(); }
     auto hasParams() const -> bool { return !m_params.isUndefined(); }
     static auto fromJson(const QJsonObject &json) -> JrRequest;
+    // request without params issued by server itself
+    static auto fromMethod(const QString &method, const QJsonValue &id = 0) -> JrRequest;
 private:
     QString m_version, m_method;
     QJsonValue m_params{QJsonValue::Undefined}, m_id{QJsonValue::Undefined};
@@ -8,6 +8,11 @@ public:
     JrIface(QObject *parent = nullptr): QObject(parent) { }
     ~JrIface() = default;
     virtual auto request(const JrRequest &request) -> JrResponse = 0;
+    // connects changes of the value of method to changed and changes of
+    // the path leading to it to moved, empty if value is not observable
+    virtual auto watch(const QString &/*method*/, QObject */*receiver*/,
+                       const QMetaMethod &/*changed*/, const QMetaMethod &/*moved*/)
+        -> QVector<QMetaObject::Connection> { return {}; }
 };
 
 #endif // JRIFACE_HPP
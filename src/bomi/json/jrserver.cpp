@@ -1,7 +1,9 @@
 #include "jrserver.hpp"
 #include "jrclient.hpp"
 #include "jriface.hpp"
+#include "jrsubscription.hpp"
 #include "misc/log.hpp"
+#include "misc/dataevent.hpp"
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QSslSocket>
@@ -12,6 +14,25 @@ DECLARE_LOG_CONTEXT(JSON-RPC)
 
 using ServerError = QAbstractSocket::SocketError;
 
+enum EventType {
+    // to server in its thread
+    DispatchEvent = QEvent::User + 1, ClosedEvent, ErrorEvent, ParseErrorEvent,
+    // to receiver in i/o thread
+    ReplyEvent, NotifyEvent, ShutdownEvent
+};
+
+// latency is counted in buckets of [2^i, 2^(i+1)) us
+static constexpr int LatencyBuckets = 24;
+
+// handles events in i/o thread
+class JrReceiver : public QObject {
+public:
+    JrReceiver(std::function<void(QEvent*)> &&handle): m_handle(std::move(handle)) { }
+private:
+    auto customEvent(QEvent *event) -> void final { m_handle(event); }
+    std::function<void(QEvent*)> m_handle;
+};
+
 class JrTransport {
 public:
     JrTransport(JrServer *server): m_server(server) { }
@@ -25,6 +46,7 @@ public:
         { m_server->sendError(error, str); }
     virtual auto listen(const QString &address, int port) -> bool = 0;
     virtual auto serverName() const -> QString = 0;
+    virtual auto object() -> QObject* = 0;
 private:
     JrServer *m_server;
 };
@@ -67,6 +89,7 @@ struct JrTcp : public QTcpServer, public JrTransport {
     }
     auto serverName() const -> QString final
         { return serverAddress().toString() % ':'_q % _N(serverPort()); }
+    auto object() -> QObject* final { return this; }
 };
 
 struct JrLocal : public QLocalServer, public JrTransport {
@@ -94,26 +117,113 @@ struct JrLocal : public QLocalServer, public JrTransport {
         return false;
     }
     auto serverName() const -> QString final { return fullServerName(); }
+    auto object() -> QObject* final { return this; }
 };
 
 /******************************************************************************/
 
+// transport and clients live in i/o thread once listening and only
+// requests for interface are handled in the thread of server
 struct JrServer::Data {
+    JrServer *p = nullptr;
     JrConnection connection = JrConnection::Tcp;
     JrProtocol protocol = JrProtocol::Http;
     JrTransport *transport = nullptr;
     JrIface *iface = nullptr;
     ServerError error = QAbstractSocket::UnknownSocketError;
+    // in i/o thread
     QMap<QIODevice*, JrClient*> clients;
+    QHash<int, JrClient*> ids;
+    JrReceiver *receiver = nullptr;
+    QThread io;
+    // in thread of server
+    QHash<int, JrSubscriber*> subscribers;
     Error handleError;
     QString errorString = u"No Error"_q;
+    QAtomicInt latency[StageCount][LatencyBuckets];
+    auto isAsync() const -> bool { return io.isRunning(); }
+    auto subscriber(int id, bool canNotify) -> JrSubscriber*
+    {
+        auto &s = subscribers[id];
+        if (!s) {
+            s = new JrSubscriber(iface, canNotify, [=] (const QJsonArray &batch)
+                { _PostEvent(receiver, NotifyEvent, id, batch); });
+        }
+        return s;
+    }
+    auto clearSubscribers() -> void
+    {
+        qDeleteAll(subscribers);
+        subscribers.clear();
+    }
+    // invalid requests are passed too, to keep the order of replies
+    auto dispatch(int id, const QList<JrRequest> &requests, bool canNotify) -> QList<JrResponse>
+    {
+        QList<JrResponse> replies;
+        replies.reserve(requests.size());
+        for (auto &request : requests) {
+            if (!request.isValid()) {
+                _Error("Invalid request object exits.");
+                replies.push_back(_JrErrorResponse(QJsonValue::Null, JrError::InvalidRequest));
+                continue;
+            }
+            JrResponse res;
+            if (!iface)
+                res = _JrErrorResponse(request.id(), JrError::MethodNotFound);
+            else if (request.method().startsWith("rpc."_a))
+                res = subscriber(id, canNotify)->call(request);
+            else
+                res = iface->request(request);
+            if (!request.isNotification())
+                replies.push_back(res);
+        }
+        return replies;
+    }
+    static auto reply(JrClient *client, const QList<JrResponse> &replies) -> void
+    {
+        if (replies.size() == 1)
+            client->reply(replies.front());
+        else
+            client->reply(replies);
+    }
+    auto receive(QEvent *event) -> void
+    {
+        switch ((int)event->type()) {
+        case ReplyEvent: {
+            int id = 0; QList<JrResponse> replies;
+            _TakeData(event, id, replies);
+            if (auto client = ids.value(id))
+                reply(client, replies);
+            break;
+        } case NotifyEvent: {
+            int id = 0; QJsonArray batch;
+            _TakeData(event, id, batch);
+            if (auto client = ids.value(id))
+                client->notify(batch);
+            break;
+        } case ShutdownEvent:
+            for (auto dev : clients.keys()) {
+                dev->close();
+                p->removeClient(dev);
+            }
+            delete transport;
+            transport = nullptr;
+            io.quit();
+            break;
+        default:
+            break;
+        }
+    }
 };
 
 JrServer::JrServer(JrConnection connection, JrProtocol protocol, QObject *parent)
     : QObject(parent), d(new Data)
 {
+    d->p = this;
     d->connection = connection;
     d->protocol = protocol;
+    d->io.setObjectName(u"JSON-RPC"_q);
+    d->receiver = new JrReceiver([=] (QEvent *event) { d->receive(event); });
     switch (d->connection) {
     case JrConnection::Tcp:
 //    case JrConnection::Ssl:
@@ -129,12 +239,18 @@ JrServer::~JrServer()
 {
     _Info("Closing server.");
     setInterface(nullptr);
-    auto devices = d->clients.keys();
-    for (auto dev : devices) {
-        dev->close();
-        removeClient(dev);
+    if (d->isAsync()) {
+        _PostEvent(d->receiver, ShutdownEvent);
+        d->io.wait();
+    } else {
+        auto devices = d->clients.keys();
+        for (auto dev : devices) {
+            dev->close();
+            removeClient(dev);
+        }
+        delete d->transport;
     }
-    delete d->transport;
+    delete d->receiver;
     delete d;
 }
 
@@ -152,52 +268,139 @@ auto JrServer::listen(const QString &address, int port) -> bool
 {
     d->error = QAbstractSocket::UnknownSocketError;
     d->errorString = u"No Error"_q;
+    if (d->isAsync()) {
+        _Error("Already listening %%.", d->transport->serverName());
+        return false;
+    }
     if (d->transport && d->transport->listen(address, port)) {
         _Info("Listening %%.", d->transport->serverName());
+        // socket notifiers follow the thread change
+        d->transport->object()->moveToThread(&d->io);
+        d->receiver->moveToThread(&d->io);
+        d->io.start();
         return true;
     }
     _Error("Failed to listen '%%:%%': %%", address, port, errorString());
     return false;
 }
 
+SIA toRequests(const QJsonDocument &doc) -> QList<JrRequest>
+{
+    QList<JrRequest> requests;
+    if (doc.isObject())
+        requests.push_back(JrRequest::fromJson(doc.object()));
+    else if (doc.isArray()) {
+        const auto array = doc.array();
+        requests.reserve(array.size());
+        for (int i = 0; i < array.size(); ++i)
+            requests.push_back(JrRequest::fromJson(array.at(i).toObject()));
+    }
+    return requests;
+}
+
 auto JrServer::parse(JrClient *client, const QByteArray &data) -> void
 {
+    QElapsedTimer timer;
+    timer.start();
     QJsonParseError error = { 0, QJsonParseError::NoError };
     auto doc = QJsonDocument::fromJson(data, &error);
     if (error.error != QJsonParseError::NoError) {
         _Error("Cannot parse JSON: %%", error.errorString());
-        client->reply(_JrErrorResponse(QJsonValue::Null, JrError::ParseError,
-                                       error.errorString()));
+        const auto res = _JrErrorResponse(QJsonValue::Null, JrError::ParseError,
+                                          error.errorString());
+        // through the same queue as requests to keep the order of replies
+        if (client->thread() == thread())
+            client->reply(res);
+        else
+            _PostEvent(this, ParseErrorEvent, client->id(), res);
         return;
     }
+    const auto requests = toRequests(doc);
+    record(Parse, timer.nsecsElapsed());
+    dispatch(client, requests);
+}
 
-    QJsonArray array;
-    if (doc.isObject())
-        array.push_back(doc.object());
-    else if (doc.isArray())
-        array = doc.array();
-
-    QList<JrResponse> replies;
-    replies.reserve(array.size());
-    for (int i = 0; i < array.size(); ++i) {
-        const auto request = JrRequest::fromJson(array.at(i).toObject());
-        if (!request.isValid()) {
-            _Error("Invalid request object exits.");
-            replies.push_back(_JrErrorResponse(QJsonValue::Null, JrError::InvalidRequest));
-        } else {
-            JrResponse res;
-            if (d->iface)
-                res = d->iface->request(request);
-            else
-                res = _JrErrorResponse(request.id(), JrError::MethodNotFound);
-            if (!request.isNotification())
-                replies.push_back(res);
+auto JrServer::process(JrClient *client, const QJsonDocument &doc) -> void
+{
+    QElapsedTimer timer;
+    timer.start();
+    const auto requests = toRequests(doc);
+    record(Parse, timer.nsecsElapsed());
+    dispatch(client, requests);
+}
+
+auto JrServer::dispatch(JrClient *client, const QList<JrRequest> &requests) -> void
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (client->thread() == thread()) {
+        const auto replies = d->dispatch(client->id(), requests, client->canNotify());
+        record(Dispatch, timer.nsecsElapsed());
+        d->reply(client, replies);
+    } else // whole batch in one queued call
+        _PostEvent(this, DispatchEvent, client->id(), requests,
+                   client->canNotify(), timer);
+}
+
+auto JrServer::customEvent(QEvent *event) -> void
+{
+    switch ((int)event->type()) {
+    case DispatchEvent: {
+        int id = 0; QList<JrRequest> requests; bool canNotify = false;
+        QElapsedTimer timer;
+        _TakeData(event, id, requests, canNotify, timer);
+        const auto replies = d->dispatch(id, requests, canNotify);
+        // including time in queue
+        record(Dispatch, timer.nsecsElapsed());
+        _PostEvent(d->receiver, ReplyEvent, id, replies);
+        break;
+    } case ParseErrorEvent: {
+        int id = 0; JrResponse res;
+        _TakeData(event, id, res);
+        _PostEvent(d->receiver, ReplyEvent, id, QList<JrResponse>() << res);
+        break;
+    } case ClosedEvent:
+        delete d->subscribers.take(_GetData<int>(event));
+        break;
+    case ErrorEvent: {
+        ServerError error; QString errorString;
+        _TakeData(event, error, errorString);
+        sendError(error, errorString);
+        break;
+    } default:
+        break;
+    }
+}
+
+auto JrServer::record(Stage stage, qint64 ns) -> void
+{
+    const auto us = ns / 1000;
+    int bucket = 0;
+    while (bucket < LatencyBuckets - 1 && (2ll << bucket) <= us)
+        ++bucket;
+    d->latency[stage][bucket].ref();
+}
+
+auto JrServer::histogram(Stage stage) const -> QVector<int>
+{
+    QVector<int> counts(LatencyBuckets);
+    for (int i = 0; i < LatencyBuckets; ++i)
+        counts[i] = d->latency[stage][i].load();
+    return counts;
+}
+
+auto JrServer::dumpLatency() const -> void
+{
+    static const char *names[] = { "parse", "dispatch", "write" };
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const auto counts = histogram(static_cast<Stage>(stage));
+        QByteArray line;
+        for (int i = 0; i < counts.size(); ++i) {
+            if (counts[i])
+                line += "<" + QByteArray::number(2ll << i) + "us:" + QByteArray::number(counts[i]) + ' ';
         }
+        _Info("%% latency: %%", names[stage], line.trimmed());
     }
-    if (replies.size() == 1)
-        client->reply(replies.front());
-    else
-        client->reply(replies);
 }
 
 auto JrServer::addClient(QIODevice *dev, const QString &peer) -> bool
@@ -216,6 +419,7 @@ auto JrServer::addClient(QIODevice *dev, const QString &peer) -> bool
     }
     _Info("Client connected: %%", peer);
     d->clients[dev] = client;
+    d->ids[client->id()] = client;
     return true;
 }
 
@@ -224,18 +428,35 @@ auto JrServer::removeClient(QIODevice *dev) -> void
     auto client = d->clients.take(dev);
     if (client) {
         _Info("Client disconnected: %%", client->peer());
-        delete client;
+        d->ids.remove(client->id());
+        if (client->thread() == thread())
+            delete d->subscribers.take(client->id());
+        else
+            _PostEvent(this, ClosedEvent, client->id());
+        // may be in the middle of its own slot
+        client->deleteLater();
     }
 }
 
 auto JrServer::setInterface(JrIface *iface) -> void
 {
+    // subscriptions are bound to interface
+    d->clearSubscribers();
     if (d->iface)
         disconnect(d->iface, nullptr, this, nullptr);
     d->iface = iface;
     if (d->iface)
-        connect(d->iface, &JrIface::destroyed, this,
-                [=] () { if (d->iface == iface) d->iface = nullptr; });
+        connect(d->iface, &JrIface::destroyed, this, [=] () {
+            if (d->iface == iface) {
+                d->clearSubscribers();
+                d->iface = nullptr;
+            }
+        });
+}
+
+auto JrServer::iface() const -> JrIface*
+{
+    return d->iface;
 }
 
 auto JrServer::setErrorHandler(Error &&func) -> void
@@ -255,6 +476,10 @@ auto JrServer::errorString() const -> QString
 
 auto JrServer::sendError(ServerError error, const QString &errorString) -> void
 {
+    if (QThread::currentThread() != thread()) {
+        _PostEvent(this, ErrorEvent, error, errorString);
+        return;
+    }
     if (error != QAbstractSocket::RemoteHostClosedError) {
         d->error = error;
         d->errorString = errorString;
@@ -12,20 +12,30 @@ class JrServer : public QObject {
     Q_OBJECT
     using Error = std::function<void(QAbstractSocket::SocketError)>;
 public:
+    enum Stage { Parse, Dispatch, Write, StageCount };
     JrServer(JrConnection connection, JrProtocol protocol, QObject *parent = nullptr);
     ~JrServer();
     auto connection() const -> JrConnection;
     auto protocol() const -> JrProtocol;
     auto listen(const QString &address, int port = 2020) -> bool;
     auto setInterface(JrIface *iface) -> void;
+    auto iface() const -> JrIface*;
     auto serverName() const -> QString;
     auto lastError() const -> QAbstractSocket::SocketError;
     auto errorString() const -> QString;
     auto setErrorHandler(Error &&func) -> void;
+    // counts of bucket i for latency in [2^i, 2^(i+1)) us, thread-safe
+    // dispatch includes time in queue to the thread of server
+    auto histogram(Stage stage) const -> QVector<int>;
+    auto dumpLatency() const -> void;
 private:
+    auto customEvent(QEvent *event) -> void override;
+    auto record(Stage stage, qint64 ns) -> void;
+    auto dispatch(JrClient *client, const QList<JrRequest> &requests) -> void;
     auto sendError(QAbstractSocket::SocketError error,
                    const QString &errorString) -> void;
     auto parse(JrClient *client, const QByteArray &data) -> void;
+    auto process(JrClient *client, const QJsonDocument &doc) -> void;
     auto addClient(QIODevice *dev, const QString &peer = QString()) -> bool;
     auto removeClient(QIODevice *dev) -> void;
     friend class JrTransport;
@@ -0,0 +1,255 @@
+#include "jrsubscription.hpp"
+#include "jriface.hpp"
+#include "jrcommon.hpp"
+#include "misc/log.hpp"
+
+DECLARE_LOG_CONTEXT(JSON-RPC)
+
+struct JrSubscription::Data {
+    int id = 0, interval = 0;
+    QString method;
+    QJsonValue value{QJsonValue::Undefined};
+    bool dirty = false, moved = false;
+    QVector<QMetaObject::Connection> connections;
+    std::function<void(void)> dirtied;
+};
+
+JrSubscription::JrSubscription(int id, const QString &method, int interval, QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    d->id = id;
+    d->method = method;
+    d->interval = interval;
+}
+
+JrSubscription::~JrSubscription()
+{
+    for (auto &c : d->connections)
+        disconnect(c);
+    delete d;
+}
+
+auto JrSubscription::id() const -> int
+{
+    return d->id;
+}
+
+auto JrSubscription::method() const -> QString
+{
+    return d->method;
+}
+
+auto JrSubscription::interval() const -> int
+{
+    return d->interval;
+}
+
+auto JrSubscription::watch(JrIface *iface) -> bool
+{
+    for (auto &c : d->connections)
+        disconnect(c);
+    d->moved = false;
+    const auto mo = &staticMetaObject;
+    const auto change = mo->method(mo->indexOfSlot("change()"));
+    const auto move = mo->method(mo->indexOfSlot("move()"));
+    d->connections = iface->watch(d->method, this, change, move);
+    return !d->connections.isEmpty();
+}
+
+auto JrSubscription::isDirty() const -> bool
+{
+    return d->dirty;
+}
+
+auto JrSubscription::isMoved() const -> bool
+{
+    return d->moved;
+}
+
+auto JrSubscription::update(const QJsonValue &value) -> bool
+{
+    d->dirty = false;
+    if (d->value == value)
+        return false;
+    d->value = value;
+    return true;
+}
+
+auto JrSubscription::value() const -> QJsonValue
+{
+    return d->value;
+}
+
+auto JrSubscription::setDirtyCallback(std::function<void ()> &&cb) -> void
+{
+    d->dirtied = std::move(cb);
+}
+
+auto JrSubscription::change() -> void
+{
+    if (d->dirty)
+        return;
+    d->dirty = true;
+    if (d->dirtied)
+        d->dirtied();
+}
+
+auto JrSubscription::move() -> void
+{
+    d->moved = true;
+    change();
+}
+
+/******************************************************************************/
+
+// notifications are sent at most once per interval in ms
+static constexpr int DefaultInterval = 100, MinInterval = 10;
+
+SIA param(const JrRequest &request, int index, const QString &name) -> QJsonValue
+{
+    const auto params = request.params();
+    if (params.isArray())
+        return params.toArray().at(index);
+    if (params.isObject())
+        return params.toObject().value(name);
+    return QJsonValue::Undefined;
+}
+
+struct JrSubscriber::Data {
+    JrSubscriber *p = nullptr;
+    JrIface *iface = nullptr;
+    bool canNotify = false;
+    Send send;
+    QMap<int, JrSubscription*> subscriptions;
+    int lastId = 0, interval = DefaultInterval;
+    QTimer timer;
+    QElapsedTimer sent;
+    auto schedule() -> void
+    {
+        if (!timer.isActive())
+            timer.start(qMax<qint64>(0, interval - sent.elapsed()));
+    }
+    auto updateInterval() -> void
+    {
+        interval = DefaultInterval;
+        if (!subscriptions.isEmpty()) {
+            interval = INT_MAX;
+            for (auto s : subscriptions)
+                interval = qMin(interval, s->interval());
+        }
+    }
+    auto subscribe(const JrRequest &request) -> JrResponse
+    {
+        if (!canNotify)
+            return _JrErrorResponse(request.id(), JrError::InvalidRequest,
+                                    u"Subscription needs persistent connection."_q);
+        const auto method = param(request, 0, u"method"_q).toString();
+        const int ms = param(request, 1, u"interval"_q).toInt(DefaultInterval);
+        if (method.isEmpty())
+            return _JrErrorResponse(request.id(), JrError::InvalidParams);
+        // watch first not to call method which is not a property
+        auto s = new JrSubscription(++lastId, method, qMax(MinInterval, ms), p);
+        if (!s->watch(iface)) {
+            delete s;
+            return _JrErrorResponse(request.id(), JrError::InvalidParams,
+                                    u"Value cannot be observed."_q);
+        }
+        auto res = iface->request(JrRequest::fromMethod(method, request.id()));
+        if (res.isError()) {
+            delete s;
+            return res;
+        }
+        s->update(res.result);
+        s->setDirtyCallback([=] () { schedule(); });
+        subscriptions.insert(s->id(), s);
+        updateInterval();
+        QJsonObject json;
+        json[u"subscription"_q] = s->id();
+        json[u"value"_q] = res.result;
+        return { request, json };
+    }
+    auto unsubscribe(const JrRequest &request) -> JrResponse
+    {
+        const int id = param(request, 0, u"subscription"_q).toInt(-1);
+        auto s = subscriptions.take(id);
+        if (!s)
+            return _JrErrorResponse(request.id(), JrError::InvalidParams);
+        delete s;
+        updateInterval();
+        return { request, true };
+    }
+    static auto notification(const QString &method, const QJsonObject &params) -> QJsonObject
+    {
+        QJsonObject json;
+        json[u"jsonrpc"_q] = u"2.0"_q;
+        json[u"method"_q] = method;
+        json[u"params"_q] = params;
+        return json;
+    }
+    // all changes since last tick go in one batch
+    // subscription which cannot be watched anymore is dropped with
+    // rpc.unsubscribed notification
+    auto flush() -> void
+    {
+        QJsonArray batch;
+        QVector<int> dropped;
+        for (auto s : subscriptions) {
+            if (!s->isDirty())
+                continue;
+            if (s->isMoved() && !s->watch(iface)) {
+                _Warn("Subscribed value is not observable anymore: %%", s->method());
+                QJsonObject params;
+                params[u"subscription"_q] = s->id();
+                params[u"method"_q] = s->method();
+                batch.push_back(notification(u"rpc.unsubscribed"_q, params));
+                dropped.push_back(s->id());
+                continue;
+            }
+            const auto res = iface->request(JrRequest::fromMethod(s->method()));
+            const auto value = res.isError() ? QJsonValue(QJsonValue::Null) : res.result;
+            if (!s->update(value))
+                continue;
+            QJsonObject params;
+            params[u"subscription"_q] = s->id();
+            params[u"method"_q] = s->method();
+            params[u"value"_q] = value;
+            batch.push_back(notification(u"rpc.notify"_q, params));
+        }
+        if (!dropped.isEmpty()) {
+            for (auto id : dropped)
+                delete subscriptions.take(id);
+            updateInterval();
+        }
+        if (batch.isEmpty())
+            return;
+        send(batch);
+        sent.restart();
+    }
+};
+
+JrSubscriber::JrSubscriber(JrIface *iface, bool canNotify, Send &&send, QObject *parent)
+    : QObject(parent), d(new Data)
+{
+    d->p = this;
+    d->iface = iface;
+    d->canNotify = canNotify;
+    d->send = std::move(send);
+    d->timer.setSingleShot(true);
+    d->sent.start();
+    connect(&d->timer, &QTimer::timeout, this, [=] () { d->flush(); });
+}
+
+JrSubscriber::~JrSubscriber()
+{
+    delete d;
+}
+
+auto JrSubscriber::call(const JrRequest &request) -> JrResponse
+{
+    const auto method = request.method();
+    if (method == "rpc.subscribe"_a)
+        return d->subscribe(request);
+    if (method == "rpc.unsubscribe"_a)
+        return d->unsubscribe(request);
+    return _JrErrorResponse(request.id(), JrError::MethodNotFound);
+}
@@ -0,0 +1,49 @@
+#ifndef JRSUBSCRIPTION_HPP
+#define JRSUBSCRIPTION_HPP
+
+class JrIface;                          class JrRequest;
+class JrResponse;
+
+// value of a method of interface which a client is notified of
+class JrSubscription : public QObject {
+    Q_OBJECT
+public:
+    JrSubscription(int id, const QString &method, int interval, QObject *parent = nullptr);
+    ~JrSubscription();
+    auto id() const -> int;
+    auto method() const -> QString;
+    // minimum interval between notifications in ms
+    auto interval() const -> int;
+    // connects to notify signals of the value and of the path to it
+    // false if value can change without notification
+    auto watch(JrIface *iface) -> bool;
+    auto isDirty() const -> bool;
+    // path has changed and watch() should be called again
+    auto isMoved() const -> bool;
+    // clears dirty flag and returns false if value is the same as last one
+    auto update(const QJsonValue &value) -> bool;
+    auto value() const -> QJsonValue;
+    auto setDirtyCallback(std::function<void(void)> &&cb) -> void;
+private slots:
+    void change();
+    void move();
+private:
+    struct Data;
+    Data *d;
+};
+
+// subscriptions of a client, which live in the thread of interface
+class JrSubscriber : public QObject {
+    using Send = std::function<void(const QJsonArray &notifications)>;
+public:
+    // send is called with notifications changed since last tick
+    JrSubscriber(JrIface *iface, bool canNotify, Send &&send, QObject *parent = nullptr);
+    ~JrSubscriber();
+    // handles methods prefixed by "rpc."
+    auto call(const JrRequest &request) -> JrResponse;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // JRSUBSCRIPTION_HPP
@@ -2,53 +2,108 @@
 #include "json.hpp"
 #include "ui_autoloaderwidget.h"
 #include "simplelistmodel.hpp"
+#include "dirscanner.hpp"
 #include <QStyledItemDelegate>
 
 #define JSON_CLASS Autoloader
 static const auto jio = JIO(JE(enabled), JE(mode), JE(search_paths));
 JSON_DECLARE_FROM_TO_FUNCTIONS
 
+auto Autoloader::subdirs(const DirListing &root) const -> QStringList
+{
+    auto list = root.dirs;
+    std::sort(list.begin(), list.end());
+    QStringList dirs;
+    for (auto &path : search_paths) {
+        for (auto &one : list) {
+            if (path.match(one))
+                dirs.push_back(root.filePath(one));
+        }
+    }
+    return dirs;
+}
+
 auto Autoloader::autoload(const Mrl &mrl, ExtType type) const -> QStringList
 {
     if (!mrl.isLocalFile() || !enabled)
         return QStringList();
     const QFileInfo fileInfo(mrl.toLocalFile());
-    auto root = fileInfo.dir();
+    auto &scanner = DirScanner::instance();
+    const auto root = scanner.list(fileInfo.absolutePath());
     auto loaded = tryDir(fileInfo, type, root);
-    auto list = root.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-    for (auto &path : search_paths) {
-        for (auto &one : list) {
-            if (path.match(one)) {
-                auto dir = root;
-                if (dir.cd(one))
-                    loaded += tryDir(fileInfo, type, dir);
-            }
-        }
-    }
+    for (auto &dir : subdirs(root))
+        loaded += tryDir(fileInfo, type, scanner.list(dir));
     return loaded;
 }
 
+auto Autoloader::autoload(const Mrl &mrl, ExtType type, QObject *context,
+                          std::function<void(const QStringList&)> &&done) const -> void
+{
+    if (!mrl.isLocalFile() || !enabled) {
+        done(QStringList());
+        return;
+    }
+    // files of root come first and then ones of subdirectories in order
+    struct Loading {
+        QVector<QStringList> loaded;
+        int pending = 0;
+        std::function<void(const QStringList&)> done;
+        auto finish() -> void
+        {
+            if (--pending > 0)
+                return;
+            QStringList files;
+            for (auto &one : loaded)
+                files += one;
+            done(files);
+        }
+    };
+    QSharedPointer<Loading> loading(new Loading);
+    loading->done = std::move(done);
+    loading->pending = 1;
+    loading->loaded.resize(1);
+    const auto self = *this;
+    const QFileInfo fileInfo(mrl.toLocalFile());
+    auto list = [=] (const QString &path, int idx,
+                     std::function<void(const DirListing&)> &&listed) {
+        auto scan = DirScanner::instance().scan(path);
+        QObject::connect(scan, &DirScan::listed, context, [=] (const DirListing &dir) {
+            loading->loaded[idx] = self.tryDir(fileInfo, type, dir);
+            if (listed)
+                listed(dir);
+        });
+        QObject::connect(scan, &DirScan::finished, context,
+                         [=] () { loading->finish(); });
+        scan->start();
+    };
+    list(fileInfo.absolutePath(), 0, [=] (const DirListing &root) {
+        const auto dirs = self.subdirs(root);
+        loading->loaded.resize(dirs.size() + 1);
+        loading->pending += dirs.size();
+        for (int i = 0; i < dirs.size(); ++i)
+            list(dirs[i], i + 1, nullptr);
+    });
+}
+
 auto Autoloader::tryDir(const QFileInfo &fileInfo, ExtType type,
-                        const QDir &dir) const -> QStringList
+                        const DirListing &dir) const -> QStringList
 {
     Q_ASSERT(enabled);
-    if (!dir.exists())
-        return QStringList();
     QStringList files;
-    const auto filter = _ToNameFilter(type);
-    const auto all = dir.entryInfoList(filter, QDir::Files, QDir::Name);
+    auto all = dir.filter(type);
+    std::sort(all.begin(), all.end());
     const auto base = fileInfo.completeBaseName();
-    for (int i = 0; i < all.size(); ++i) {
-        if (all[i].fileName() == fileInfo.fileName())
+    for (auto &name : all) {
+        if (name == fileInfo.fileName())
             continue;
         if (mode != AutoloadMode::Folder) {
             if (mode == AutoloadMode::Matched) {
-                if (base != all[i].completeBaseName())
+                if (base != name.left(name.lastIndexOf('.'_q)))
                     continue;
-            } else if (!all[i].fileName().contains(base))
+            } else if (!name.contains(base))
                 continue;
         }
-        files.push_back(all[i].absoluteFilePath());
+        files.push_back(dir.filePath(name));
     }
     return files;
 }
@@ -5,17 +5,25 @@
 #include "enum/autoloadmode.hpp"
 #include "player/mrl.hpp"
 
+struct DirListing;
+
 struct Autoloader {
     DECL_EQ(Autoloader, &T::search_paths, &T::enabled, &T::mode)
     auto toJson() const -> QJsonObject;
     auto setFromJson(const QJsonObject &json) -> bool;
+    // blocks until directories are listed, for worker threads
     auto autoload(const Mrl &mrl, ExtType type) const -> QStringList;
+    // lists directories in background and calls done in thread of context
+    auto autoload(const Mrl &mrl, ExtType type, QObject *context,
+                  std::function<void(const QStringList&)> &&done) const -> void;
 
     QList<MatchString> search_paths;
     bool enabled = false;
     AutoloadMode mode = AutoloadMode::Matched;
 private:
-    auto tryDir(const QFileInfo &fileInfo, ExtType type, const QDir &dir) const -> QStringList;
+    auto tryDir(const QFileInfo &fileInfo, ExtType type,
+                const DirListing &dir) const -> QStringList;
+    auto subdirs(const DirListing &root) const -> QStringList;
 };
 
 Q_DECLARE_METATYPE(Autoloader)
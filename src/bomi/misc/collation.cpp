@@ -0,0 +1,31 @@
+#include "collation.hpp"
+#include "parallel.hpp"
+#include <QCollator>
+
+auto _CollationOrder(const QStringList &strings) -> QVector<int>
+{
+    static constexpr int ItemsPerJob = 2048;
+    const int size = strings.size();
+    const int jobs = _ParallelJobs(size, ItemsPerJob);
+    const int chunk = (size + jobs - 1) / jobs;
+    // QCollatorSortKey cannot be default constructed, so keep one list per job
+    std::vector<std::vector<QCollatorSortKey>> keys(jobs);
+    _ParallelFor(jobs, [&] (int job) {
+        // QCollator is not thread-safe
+        QCollator c;
+        c.setNumericMode(true);
+        const int from = job * chunk, to = qMin(from + chunk, size);
+        auto &list = keys[job];
+        list.reserve(qMax(0, to - from));
+        for (int i = from; i < to; ++i)
+            list.push_back(c.sortKey(strings[i]));
+    });
+
+    auto key = [&] (int i) -> const QCollatorSortKey&
+        { return keys[i / chunk][i % chunk]; };
+    QVector<int> order(size);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&] (int lhs, int rhs)
+        { return key(lhs).compare(key(rhs)) < 0; });
+    return order;
+}
@@ -0,0 +1,24 @@
+#ifndef COLLATION_HPP
+#define COLLATION_HPP
+
+// order of strings in locale-aware numeric collation
+// sort keys are computed once for each string, in parallel for long lists
+auto _CollationOrder(const QStringList &strings) -> QVector<int>;
+
+// stable sort by strings of key(item) in locale-aware numeric collation
+template<class Container, class Key>
+SIA _CollatedSort(Container &c, Key key) -> void
+{
+    QStringList strings;
+    strings.reserve(c.size());
+    for (const auto &item : c)
+        strings.push_back(key(item));
+    const auto order = _CollationOrder(strings);
+    Container sorted;
+    sorted.reserve(c.size());
+    for (int idx : order)
+        sorted.push_back(c[idx]);
+    c.swap(sorted);
+}
+
+#endif // COLLATION_HPP
@@ -0,0 +1,189 @@
+#include "dirscanner.hpp"
+#include "misc/collation.hpp"
+#include <QDirIterator>
+#include <QThreadPool>
+
+auto DirListing::filter(ExtTypes exts) const -> QStringList
+{
+    QSet<QString> suffixes;
+    for (auto &ext : _ExtList(exts))
+        suffixes.insert(ext.toLower());
+    QStringList list;
+    for (auto &name : files) {
+        const int dot = name.lastIndexOf('.'_q);
+        if (dot >= 0 && suffixes.contains(name.mid(dot + 1).toLower()))
+            list.push_back(name);
+    }
+    return list;
+}
+
+/******************************************************************************/
+
+struct DirScan::Data {
+    QString root;
+    bool recursive = false;
+    QAtomicInt canceled = 0;
+    QSet<QString> visited;
+    auto isCanceled() const -> bool { return canceled.load(); }
+};
+
+DirScan::DirScan(const QString &root, bool recursive)
+    : d(new Data)
+{
+    d->root = root;
+    d->recursive = recursive;
+}
+
+DirScan::~DirScan()
+{
+    delete d;
+}
+
+auto DirScan::start() -> void
+{
+    DirScanner::instance().start(this);
+}
+
+auto DirScan::root() const -> QString
+{
+    return d->root;
+}
+
+auto DirScan::isRecursive() const -> bool
+{
+    return d->recursive;
+}
+
+auto DirScan::cancel() -> void
+{
+    d->canceled.store(1);
+}
+
+auto DirScan::isCanceled() const -> bool
+{
+    return d->isCanceled();
+}
+
+auto DirScan::run() -> void
+{
+    auto &scanner = DirScanner::instance();
+    std::function<void(const QString&)> scan = [&] (const QString &path) {
+        // symbolic links may make a loop
+        const auto canonical = QFileInfo(path).canonicalFilePath();
+        if (d->isCanceled() || d->visited.contains(canonical))
+            return;
+        d->visited.insert(canonical);
+        auto listing = scanner.list(path, &d->canceled);
+        if (d->isCanceled())
+            return;
+        emit listed(listing);
+        if (!d->recursive)
+            return;
+        _CollatedSort(listing.dirs, [] (const QString &name) { return name; });
+        for (auto &dir : listing.dirs)
+            scan(listing.filePath(dir));
+    };
+    scan(d->root);
+    emit finished(d->isCanceled());
+    deleteLater();
+}
+
+/******************************************************************************/
+
+struct DirScanner::Data {
+    // directories on network may block for long, so use own threads
+    QThreadPool pool;
+    mutable QMutex mutex;
+    // cost is the number of entries
+    QCache<QString, DirListing> cache{256 * 1024};
+    quint64 hits = 0, misses = 0;
+};
+
+DirScanner::DirScanner()
+    : d(new Data)
+{
+    qRegisterMetaType<DirListing>();
+    d->pool.setMaxThreadCount(2);
+}
+
+DirScanner::~DirScanner()
+{
+    delete d;
+}
+
+auto DirScanner::instance() -> DirScanner&
+{
+    static DirScanner scanner;
+    return scanner;
+}
+
+auto DirScanner::list(const QString &path, const QAtomicInt *cancel) -> DirListing
+{
+    const QFileInfo info(path);
+    if (!info.isDir())
+        return DirListing();
+    const auto key = info.absoluteFilePath();
+    const auto modified = info.lastModified();
+    {
+        QMutexLocker locker(&d->mutex);
+        const auto cached = d->cache.object(key);
+        if (cached && cached->modified == modified) {
+            ++d->hits;
+            return *cached;
+        }
+        ++d->misses;
+    }
+    const auto start = QDateTime::currentDateTime();
+    DirListing listing;
+    listing.path = key;
+    listing.modified = modified;
+    // type of entry comes from readdir() without stat() where supported
+    QDirIterator it(key, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        if (cancel && cancel->load())
+            return DirListing();
+        it.next();
+        (it.fileInfo().isDir() ? listing.dirs : listing.files).push_back(it.fileName());
+    }
+    // modified time may have coarse resolution,
+    // so changes within the same second could be missed
+    if (modified.secsTo(start) >= 2) {
+        QMutexLocker locker(&d->mutex);
+        const int cost = listing.files.size() + listing.dirs.size() + 1;
+        d->cache.insert(key, new DirListing(listing), cost);
+    }
+    return listing;
+}
+
+auto DirScanner::scan(const QString &path, bool recursive) -> DirScan*
+{
+    return new DirScan(path, recursive);
+}
+
+auto DirScanner::start(DirScan *scan) -> void
+{
+    class Job : public QRunnable {
+    public:
+        Job(DirScan *scan): m_scan(scan) { }
+        auto run() -> void override { m_scan->run(); }
+    private:
+        DirScan *m_scan;
+    };
+    d->pool.start(new Job(scan));
+}
+
+auto DirScanner::clear() -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->cache.clear();
+}
+
+auto DirScanner::stats() const -> DirScannerStats
+{
+    QMutexLocker locker(&d->mutex);
+    DirScannerStats stats;
+    stats.hits = d->hits;
+    stats.misses = d->misses;
+    stats.count = d->cache.count();
+    return stats;
+}
@@ -0,0 +1,64 @@
+#ifndef DIRSCANNER_HPP
+#define DIRSCANNER_HPP
+
+// entries of a directory in the order of file system, hidden ones excluded
+struct DirListing {
+    QString path; // absolute path of directory
+    QDateTime modified;
+    QStringList files, dirs;
+    auto isEmpty() const -> bool { return files.isEmpty() && dirs.isEmpty(); }
+    auto filePath(const QString &name) const -> QString
+        { return path % '/'_q % name; }
+    // names of files whose suffix is one of exts
+    auto filter(ExtTypes exts) const -> QStringList;
+};
+
+Q_DECLARE_METATYPE(DirListing)
+
+// asynchronous scan created by DirScanner::scan()
+// connect signals and then start() it; deletes itself after finished()
+class DirScan : public QObject {
+    Q_OBJECT
+public:
+    ~DirScan();
+    auto start() -> void;
+    auto root() const -> QString;
+    auto isRecursive() const -> bool;
+    // stops scanning as soon as possible and emits finished(true)
+    auto cancel() -> void;
+    auto isCanceled() const -> bool;
+signals:
+    // a directory is followed by its subdirectories in collation order
+    void listed(const DirListing &listing);
+    void finished(bool canceled);
+private:
+    DirScan(const QString &root, bool recursive);
+    auto run() -> void;
+    friend class DirScanner;
+    struct Data;
+    Data *d;
+};
+
+struct DirScannerStats { quint64 hits = 0, misses = 0; int count = 0; };
+
+// lists directories in worker threads and caches listings by modified time
+// of directory so that opening the same folder again costs a stat()
+class DirScanner {
+public:
+    static auto instance() -> DirScanner&;
+    // thread-safe and blocking, returns empty listing when canceled
+    auto list(const QString &path, const QAtomicInt *cancel = nullptr) -> DirListing;
+    // listed() of returned scan is emitted from worker thread
+    auto scan(const QString &path, bool recursive = false) -> DirScan*;
+    auto clear() -> void;
+    auto stats() const -> DirScannerStats;
+private:
+    auto start(DirScan *scan) -> void;
+    friend class DirScan;
+    DirScanner();
+    ~DirScanner();
+    struct Data;
+    Data *d;
+};
+
+#endif // DIRSCANNER_HPP
@@ -0,0 +1,218 @@
+#include "jsonbinary.hpp"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtEndian>
+#include <cmath>
+
+enum Major : uchar {
+    Unsigned = 0, Negative = 1 << 5, Bytes = 2 << 5, Text = 3 << 5,
+    Array = 4 << 5, Map = 5 << 5, Tag = 6 << 5, Simple = 7 << 5
+};
+
+enum SimpleValue : uchar {
+    False = Simple | 20, True = Simple | 21, Null = Simple | 22,
+    Undefined = Simple | 23, Float64 = Simple | 27
+};
+
+static constexpr int MaxDepth = 64;
+
+static auto writeHead(QByteArray &data, uchar major, quint64 arg) -> void
+{
+    auto push = [&] (int bytes) {
+        char buffer[8];
+        for (int i = bytes - 1; i >= 0; --i, arg >>= 8)
+            buffer[i] = char(arg & 0xff);
+        data.append(buffer, bytes);
+    };
+    if (arg < 24)
+        data.append(char(major | arg));
+    else if (arg <= 0xff) {
+        data.append(char(major | 24));
+        push(1);
+    } else if (arg <= 0xffff) {
+        data.append(char(major | 25));
+        push(2);
+    } else if (arg <= 0xffffffffull) {
+        data.append(char(major | 26));
+        push(4);
+    } else {
+        data.append(char(major | 27));
+        push(8);
+    }
+}
+
+static auto writeText(QByteArray &data, const QString &text) -> void
+{
+    const auto utf8 = text.toUtf8();
+    writeHead(data, Text, utf8.size());
+    data.append(utf8);
+}
+
+static auto writeDouble(QByteArray &data, double value) -> void
+{
+    // 2^53 is the largest integer which double represents exactly
+    static constexpr double Exact = 9007199254740992.0;
+    if (value == std::floor(value) && std::abs(value) <= Exact
+            && !(value == 0 && std::signbit(value))) {
+        if (value >= 0)
+            writeHead(data, Unsigned, quint64(value));
+        else
+            writeHead(data, Negative, quint64(-value - 1));
+        return;
+    }
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    char buffer[9];
+    buffer[0] = char(Float64);
+    qToBigEndian(bits, reinterpret_cast<uchar*>(buffer + 1));
+    data.append(buffer, sizeof(buffer));
+}
+
+auto _JsonToBinary(const QJsonValue &json, QByteArray &data) -> void
+{
+    switch (json.type()) {
+    case QJsonValue::Null:
+        data.append(char(Null));
+        break;
+    case QJsonValue::Bool:
+        data.append(char(json.toBool() ? True : False));
+        break;
+    case QJsonValue::Double:
+        writeDouble(data, json.toDouble());
+        break;
+    case QJsonValue::String:
+        writeText(data, json.toString());
+        break;
+    case QJsonValue::Array: {
+        const auto array = json.toArray();
+        writeHead(data, Array, array.size());
+        for (const auto &value : array)
+            _JsonToBinary(value, data);
+        break;
+    } case QJsonValue::Object: {
+        const auto object = json.toObject();
+        writeHead(data, Map, object.size());
+        for (auto it = object.begin(); it != object.end(); ++it) {
+            writeText(data, it.key());
+            _JsonToBinary(it.value(), data);
+        }
+        break;
+    } case QJsonValue::Undefined:
+        data.append(char(Undefined));
+        break;
+    }
+}
+
+auto _JsonToBinary(const QJsonValue &json) -> QByteArray
+{
+    QByteArray data;
+    _JsonToBinary(json, data);
+    return data;
+}
+
+namespace {
+
+struct Reader {
+    const uchar *pos, *end;
+    bool ok = true;
+    auto fail() -> QJsonValue { ok = false; return QJsonValue::Undefined; }
+    auto arg(uchar info, quint64 &value) -> bool
+    {
+        if (info < 24) {
+            value = info;
+            return true;
+        }
+        if (info > 27)
+            return false;
+        const int bytes = 1 << (info - 24);
+        if (end - pos < bytes)
+            return false;
+        value = 0;
+        for (int i = 0; i < bytes; ++i)
+            value = (value << 8) | *pos++;
+        return true;
+    }
+    auto text(quint64 size) -> QString
+    {
+        if (quint64(end - pos) < size) {
+            ok = false;
+            return QString();
+        }
+        const auto str = QString::fromUtf8(reinterpret_cast<const char*>(pos), size);
+        pos += size;
+        return str;
+    }
+    auto read(int depth) -> QJsonValue
+    {
+        if (pos >= end || depth > MaxDepth)
+            return fail();
+        const uchar head = *pos++;
+        const uchar major = head & 0xe0, info = head & 0x1f;
+        if (major == Simple) {
+            switch (head) {
+            case False: return false;
+            case True:  return true;
+            case Null:  return QJsonValue::Null;
+            case Float64: {
+                if (end - pos < 8)
+                    return fail();
+                const auto bits = qFromBigEndian<quint64>(pos);
+                pos += 8;
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                return value;
+            } default:
+                return fail();
+            }
+        }
+        quint64 value = 0;
+        if (!arg(info, value))
+            return fail();
+        switch (major) {
+        case Unsigned:
+            return double(value);
+        case Negative:
+            return -1.0 - double(value);
+        case Text: {
+            const auto str = text(value);
+            return ok ? QJsonValue(str) : fail();
+        } case Array: {
+            // every item takes one byte at least
+            if (value > quint64(end - pos))
+                return fail();
+            QJsonArray array;
+            for (quint64 i = 0; i < value && ok; ++i)
+                array.append(read(depth + 1));
+            return ok ? QJsonValue(array) : fail();
+        } case Map: {
+            if (value > quint64(end - pos) / 2)
+                return fail();
+            QJsonObject object;
+            for (quint64 i = 0; i < value && ok; ++i) {
+                quint64 size = 0;
+                if (pos >= end || (*pos & 0xe0) != Text || !arg(*pos++ & 0x1f, size))
+                    return fail();
+                const auto key = text(size);
+                if (ok)
+                    object.insert(key, read(depth + 1));
+            }
+            return ok ? QJsonValue(object) : fail();
+        } default:
+            return fail();
+        }
+    }
+};
+
+}
+
+auto _JsonFromBinary(const QByteArray &data, int from) -> QJsonValue
+{
+    if (from < 0 || from >= data.size())
+        return QJsonValue::Undefined;
+    const auto begin = reinterpret_cast<const uchar*>(data.constData());
+    Reader reader{begin + from, begin + data.size()};
+    const auto json = reader.read(0);
+    if (!reader.ok || reader.pos != reader.end)
+        return QJsonValue::Undefined;
+    return json;
+}
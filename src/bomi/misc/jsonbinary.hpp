@@ -0,0 +1,13 @@
+#ifndef JSONBINARY_HPP
+#define JSONBINARY_HPP
+
+#include <QJsonValue>
+
+// compact binary form of json in a subset of CBOR (RFC 7049)
+// integral numbers are stored as integers and others as doubles
+auto _JsonToBinary(const QJsonValue &json) -> QByteArray;
+auto _JsonToBinary(const QJsonValue &json, QByteArray &data) -> void;
+// returns undefined value for malformed data
+auto _JsonFromBinary(const QByteArray &data, int from = 0) -> QJsonValue;
+
+#endif // JSONBINARY_HPP
@@ -5,6 +5,8 @@
 #include "tmp/algorithm.hpp"
 #include <QTextCodec>
 #include <QBuffer>
+#include <QElapsedTimer>
+#include <QSemaphore>
 #include <cstdlib>
 
 #if HAVE_SYSTEMD
@@ -22,12 +24,13 @@ static const std::array<int, 7> jp = [] () {
 }();
 #endif
 
+DECLARE_LOG_CONTEXT(Log)
+
 static Log::Level lvStdOut  = Log::Trace;
 static Log::Level lvStdErr  = Log::Off;
 static Log::Level lvJournal = Log::Off;
 static Log::Level lvFile    = Log::Off;
 static Log::Level lvViewer  = Log::Off;
-static Log::Level lvMax     = Log::Trace;
 
 static QReadWriteLock s_rwLock;
 static QHash<QObject*, int> s_subscribers;
@@ -54,11 +57,197 @@ SIA print(FILE *file, const QByteArray &log) -> void
     fflush(file);
 }
 
-auto Log::print(Level lv, const QByteArray &log) -> void
+// power of 2
+static constexpr uint QueueSize = 8192;
+// lines written at once by sink
+static constexpr int BatchSize = 512;
+// sink wakes up by itself at least this often in ms
+static constexpr int SinkWait = 50;
+
+struct LogRecord {
+    QAtomicInteger<uint> sequence;
+    Log::Level level = Log::Off;
+    // text is formatted already if context is empty
+    QByteArray context, text;
+};
+
+// bounded lock-free queue of multiple producers and a single consumer
+// which writes lines in batches from its own thread
+// lines are dropped and counted while the queue is full
+class LogSink : public QThread {
+public:
+    LogSink()
+    {
+        for (uint i = 0; i < QueueSize; ++i)
+            m_records[i].sequence.store(i);
+        start(LowPriority);
+    }
+    ~LogSink()
+    {
+        m_quit.store(1);
+        wake();
+        wait();
+    }
+    auto push(Log::Level lv, const QByteArray &context, const QByteArray &text) -> bool
+    {
+        uint pos = m_tail.load();
+        LogRecord *r = nullptr;
+        for (;;) {
+            r = &m_records[pos & (QueueSize - 1)];
+            const int diff = int(r->sequence.loadAcquire() - pos);
+            if (!diff) {
+                if (m_tail.testAndSetRelaxed(pos, pos + 1))
+                    break;
+                pos = m_tail.load();
+            } else if (diff < 0) {
+                m_dropped.ref();
+                return false;
+            } else
+                pos = m_tail.load();
+        }
+        r->level = lv;
+        r->context = context;
+        r->text = text;
+        r->sequence.storeRelease(pos + 1);
+        if (Q_UNLIKELY(m_sleeping.load()))
+            wake();
+        return true;
+    }
+    // waits until everything pushed so far is written
+    auto flush() -> void
+    {
+        const uint target = m_tail.load();
+        wake();
+        QElapsedTimer timer;
+        timer.start();
+        while (int(m_done.loadAcquire() - target) < 0 && timer.elapsed() < 1000)
+            QThread::msleep(1);
+    }
+private:
+    // only one waker which clears the flag releases the semaphore
+    auto wake() -> void
+    {
+        if (m_sleeping.testAndSetOrdered(1, 0))
+            m_wake.release();
+    }
+    auto run() -> void final
+    {
+        for (;;) {
+            if (drain())
+                continue;
+            if (m_quit.load())
+                break;
+            // missed wakeup costs at most SinkWait
+            m_sleeping.fetchAndStoreOrdered(1);
+            bool woken = false;
+            if (!isReady())
+                woken = m_wake.tryAcquire(1, SinkWait);
+            // consume the permit of waker which cleared the flag meanwhile
+            if (!woken && !m_sleeping.testAndSetOrdered(1, 0))
+                m_wake.acquire();
+        }
+    }
+    auto isReady() const -> bool
+    {
+        return m_records[m_head & (QueueSize - 1)].sequence.loadAcquire() == m_head + 1;
+    }
+    auto drain() -> int
+    {
+        int count = 0;
+        for (; count < BatchSize && isReady(); ++count) {
+            auto &r = m_records[m_head & (QueueSize - 1)];
+            const auto lv = r.level;
+            const auto context = std::move(r.context);
+            const auto text = std::move(r.text);
+            r.sequence.storeRelease(m_head + QueueSize);
+            ++m_head;
+            if (context.isEmpty())
+                append(lv, text);
+            else
+                append(lv, Log::parse(lv, context.constData(), text));
+        }
+        if (const int dropped = m_dropped.fetchAndStoreRelaxed(0)) {
+            append(Log::Warn, Log::parse(Log::Warn, "Log", "%% lines dropped\n", dropped));
+            ++count;
+        }
+        if (count)
+            commit();
+        m_done.storeRelease(m_head);
+        return count;
+    }
+    auto append(Log::Level lv, const QByteArray &log) -> void
+    {
+#if HAVE_SYSTEMD
+        if (lv <= lvJournal)
+            sd_journal_print(jp[lv], "%s", log.constData());
+#endif
+        if (lv <= lvStdOut)
+            m_out += encodeForTerminal(log);
+        if (lv <= lvStdErr)
+            m_err += encodeForTerminal(log);
+        if (lv <= lvFile && s_file)
+            m_file += log;
+        if (lv <= lvViewer && !s_subscribers.isEmpty()) {
+            auto str = QString::fromUtf8(log);
+            if (str.endsWith('\n'_q))
+                str.chop(1);
+            m_levels.push_back(lv);
+            m_lines.push_back(str);
+        }
+    }
+    auto commit() -> void
+    {
+        auto print = [] (FILE *file, QByteArray &buffer) {
+            if (!buffer.isEmpty())
+                ::print(file, buffer);
+            buffer.clear();
+        };
+        print(stdout, m_out);
+        print(stderr, m_err);
+        if (s_file)
+            print(s_file.data(), m_file);
+        if (!m_lines.isEmpty() && qApp) {
+            s_rwLock.lockForRead();
+            auto &s = _C(s_subscribers);
+            for (auto it = s.begin(); it != s.end(); ++it)
+                _PostEvent(it.key(), it.value(), m_levels, m_lines);
+            s_rwLock.unlock();
+        }
+        m_levels.clear();
+        m_lines.clear();
+    }
+    LogRecord m_records[QueueSize];
+    QAtomicInteger<uint> m_tail{0}, m_done{0};
+    uint m_head = 0;
+    QAtomicInt m_dropped{0}, m_quit{0}, m_sleeping{0};
+    QSemaphore m_wake;
+    QByteArray m_out, m_err, m_file;
+    QVector<Log::Level> m_levels;
+    QStringList m_lines;
+};
+
+static QAtomicInt s_sinkAlive{0}, s_configured{0};
+
+static auto sink() -> LogSink*
+{
+    // sink reads options without lock, so it starts after setOption()
+    if (!s_configured.loadAcquire())
+        return nullptr;
+    struct Holder {
+        Holder() { s_sinkAlive.store(1); }
+        ~Holder() { s_sinkAlive.store(0); }
+        LogSink sink;
+    };
+    static Holder holder;
+    return s_sinkAlive.load() ? &holder.sink : nullptr;
+}
+
+// for fatal error and for lines after sink is destroyed on exit
+static auto printNow(Log::Level lv, const QByteArray &log) -> void
 {
 #if HAVE_SYSTEMD
     if (lv <= lvJournal)
-        sd_journal_print(jp[lv], log.constData());
+        sd_journal_print(jp[lv], "%s", log.constData());
 #endif
     if (lv <= lvStdOut)
         ::print(stdout, encodeForTerminal(log));
@@ -66,18 +255,29 @@ auto Log::print(Level lv, const QByteArray &log) -> void
         ::print(stderr, encodeForTerminal(log));
     if (lv <= lvFile && s_file)
         ::print(s_file.data(), log);
-    if (lv <= lvViewer && !s_subscribers.isEmpty()) {
-        s_rwLock.lockForRead();
-        auto &s = _C(s_subscribers);
-        auto str = QString::fromUtf8(log); str.chop(1);
-        for (auto it = s.begin(); it != s.end(); ++it)
-            _PostEvent(it.key(), it.value(), lv, str);
-        s_rwLock.unlock();
+}
+
+auto Log::print(Level lv, const QByteArray &log) -> void
+{
+    print(lv, QByteArray(), log);
+}
+
+auto Log::print(Level lv, const QByteArray &context, const QByteArray &text) -> void
+{
+    auto s = sink();
+    if (s && lv != Fatal) {
+        s->push(lv, context, text);
+        return;
     }
+    if (s)
+        s->flush();
+    printNow(lv, context.isEmpty() ? text : parse(lv, context.constData(), text));
     if (lv == Fatal)
         abort();
 }
 
+Log::Level Log::m_maxLevel = Log::Trace;
+
 static const std::array<Log::Level, 4> lvQt = []() {
     std::array<Log::Level, 4> ret;
     ret[QtDebugMsg] = Log::Debug;
@@ -103,22 +303,22 @@ auto Log::setOption(const LogOption &option) -> void
     lvJournal = option.level(LogOutput::Journal);
     lvFile    = option.level(LogOutput::File);
     lvViewer  = option.level(LogOutput::Viewer);
-    lvMax = tmp::max(lvStdOut, lvStdErr, lvFile, lvViewer);
+    m_maxLevel = tmp::max(lvStdOut, lvStdErr, lvFile, lvViewer);
 #if HAVE_SYSTEMD
-    lvMax = tmp::max(lvMax, lvJournal);
+    m_maxLevel = tmp::max(m_maxLevel, lvJournal);
 #endif
 
     s_local8BitIsUtf8 = QTextCodec::codecForLocale()->mibEnum() == 106;
 
-    if (!lvFile)
-        return;
-    auto path = option.file().toLocal8Bit();
-    auto pf = fopen(path.constData(), "a");
-    if (!pf) {
-        qDebug("Cannot open file: %s\n", path.constData());
-        return;
+    if (lvFile) {
+        auto path = option.file().toLocal8Bit();
+        auto pf = fopen(path.constData(), "a");
+        if (pf)
+            s_file = QSharedPointer<FILE>(pf, fclose);
+        else
+            qDebug("Cannot open file: %s\n", path.constData());
     }
-    s_file = QSharedPointer<FILE>(pf, fclose);
+    s_configured.storeRelease(1);
 }
 
 auto Log::option() -> const LogOption&
@@ -126,9 +326,34 @@ auto Log::option() -> const LogOption&
     return s_option;
 }
 
-auto Log::maximumLevel() -> Level
+auto Log::benchmark() -> void
 {
-    return lvMax;
+    static constexpr int count = 10000000;
+    const QSize size(1920, 1080);
+    volatile double fps = 59.94;
+    volatile int sink = 0;
+    auto measure = [&] (auto &&func) {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < count; ++i) {
+            func();
+            sink = sink + 1;
+        }
+        return timer.nsecsElapsed() / double(count);
+    };
+    const auto level = m_maxLevel;
+    m_maxLevel = Info;
+    const auto base = measure([] () { });
+    const auto disabled = measure([&] () {
+        _WriteLog(Trace, "render queued frame(%%), avgfps: %%", size, fps);
+    });
+    const auto formatted = measure([&] () {
+        sink = sink + Log::parse(Trace, getLogContext(), "render queued frame(%%), avgfps: %%",
+                                 size, fps).size();
+    });
+    _Info("%% calls: disabled %%ns, formatting %%ns per call",
+          count, disabled - base, formatted - base);
+    m_maxLevel = level;
 }
 
 auto Log::subscribe(QObject *o, int event) -> int
@@ -1,6 +1,11 @@
 #ifndef LOG_HPP
 #define LOG_HPP
 
+// _Debug() and _Trace() above this level are stripped at compile time
+#ifndef BOMI_LOG_LEVEL
+#define BOMI_LOG_LEVEL 6
+#endif
+
 struct LogOption;
 
 SIA _ToLog(char n) -> QByteArray { return QByteArray::number(n); }
@@ -61,14 +66,15 @@ public:
     template<class F>
     static auto write(Level level, F &&getLogText) -> void
     {
-        if (level <= maximumLevel())
+        // getLogText() is evaluated only when level is enabled
+        if (Q_UNLIKELY(level <= maximumLevel()))
             print(level, std::move(getLogText() += '\n'));
     }
     template<class... Args>
     static auto write(const char *ctx, Level level, const QByteArray &format,
                       const Args &... args) -> void
     {
-        if (level <= maximumLevel())
+        if (Q_UNLIKELY(level <= maximumLevel()))
             print(level, std::move(Helper(level, ctx, format, args...).log() += '\n'));
     }
     template<class... Args>
@@ -84,13 +90,18 @@ public:
         const int index = m_options.indexOf(name);
         return index < 0 ? Off : (Level)index;
     }
+    // queued and written by background thread except for Fatal
     static auto print(Level lv, const QByteArray &log) -> void;
-    static auto maximumLevel() -> Level;
+    // same as print(lv, parse(lv, context, text)) but formatted in background
+    static auto print(Level lv, const QByteArray &context, const QByteArray &text) -> void;
+    static auto maximumLevel() -> Level { return m_maxLevel; }
     static auto setOption(const LogOption &option) -> void;
     static auto option() -> const LogOption&;
     static auto qt(QtMsgType type, const QMessageLogContext &context, const QString &msg) -> void;
     static auto subscribe(QObject *o, int event) -> int;
     static auto unsubscribe(QObject *o) -> void;
+    // cost per call of disabled and enabled levels
+    static auto benchmark() -> void;
 private:
     struct Helper {
         template<class... Args>
@@ -157,8 +168,16 @@ private:
 #define _Error(fmt, ...) _WriteLog(Log::Error, fmt, ##__VA_ARGS__)
 #define _Warn(fmt, ...)  _WriteLog(Log::Warn,  fmt, ##__VA_ARGS__)
 #define _Info(fmt, ...)  _WriteLog(Log::Info,  fmt, ##__VA_ARGS__)
+#if BOMI_LOG_LEVEL >= 5
 #define _Debug(fmt, ...) _WriteLog(Log::Debug, fmt, ##__VA_ARGS__)
+#else
+#define _Debug(fmt, ...) ((void)0)
+#endif
+#if BOMI_LOG_LEVEL >= 6
 #define _Trace(fmt, ...) _WriteLog(Log::Trace, fmt, ##__VA_ARGS__)
+#else
+#define _Trace(fmt, ...) ((void)0)
+#endif
 
 Q_DECLARE_METATYPE(Log::Level)
 
@@ -215,23 +215,31 @@ auto LogViewer::customEvent(QEvent *ev) -> void
         return;
     if (d->stop)
         return;
-    LogEntry entry;
-    _TakeData(ev, entry.level, entry.message);
-    Q_ASSERT(entry.message.at(3) == '['_q);
-    const int idx = entry.message.indexOf(']'_q, 4);
-    if (idx < 0) {
-        qDebug("Unknown logging context. Skip it.");
-        return;
+    QVector<Log::Level> levels;
+    QStringList messages;
+    _TakeData(ev, levels, messages);
+    bool sort = false;
+    for (int i = 0; i < messages.size(); ++i) {
+        LogEntry entry;
+        entry.level = levels[i];
+        entry.message = messages[i];
+        Q_ASSERT(entry.message.at(3) == '['_q);
+        const int idx = entry.message.indexOf(']'_q, 4);
+        if (idx < 0) {
+            qDebug("Unknown logging context. Skip it.");
+            continue;
+        }
+        entry.context = entry.message.mid(4, idx -4 );
+        d->model.append(entry);
+        if (d->newContext(entry.context, true))
+            sort = true;
     }
-    entry.context = entry.message.mid(4, idx -4 );
-    d->model.append(entry);
-
-    if (d->newContext(entry.context, true)) {
+    if (sort) {
         d->ui.context->sortItems();
         d->syncContext();
     }
 
-    if (d->model.rows() > d->lines)
+    while (d->model.rows() > d->lines)
         d->model.remove(0);
     if (d->ui.autoscroll->isChecked())
         d->ui.view->scrollToBottom();
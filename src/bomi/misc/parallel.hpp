@@ -0,0 +1,40 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <QThreadPool>
+#include <QSemaphore>
+
+// runs func(job) for each job in [0, jobs) in global thread pool and returns
+// when all of them have finished; job 0 runs in calling thread
+template<class F>
+SIA _ParallelFor(int jobs, const F &func) -> void
+{
+    if (jobs < 2) {
+        if (jobs > 0)
+            func(0);
+        return;
+    }
+    class Job : public QRunnable {
+    public:
+        Job(const F &func, int job, QSemaphore *done)
+            : m_func(func), m_job(job), m_done(done) { }
+        auto run() -> void override { m_func(m_job); m_done->release(); }
+    private:
+        const F &m_func; int m_job; QSemaphore *m_done;
+    };
+    auto pool = QThreadPool::globalInstance();
+    QSemaphore done;
+    for (int job = 1; job < jobs; ++job)
+        pool->start(new Job(func, job, &done));
+    func(0);
+    done.acquire(jobs - 1);
+}
+
+// number of jobs for amount of work to keep every thread of pool busy
+SIA _ParallelJobs(int work, int workPerJob) -> int
+{
+    return qBound(1, work / workPerJob,
+                  QThreadPool::globalInstance()->maxThreadCount() + 1);
+}
+
+#endif // PARALLEL_HPP
@@ -117,12 +117,12 @@ auto SimpleListModelBase::clear() -> void
 
 auto SimpleListModelBase::insertRows(int row, int count, const QModelIndex &parent) -> bool
 {
+    if (count <= 0 || !_InRange(0, row, d->rows))
+        return false;
     beginInsertRows(parent, row, row + count - 1);
-    for (int i = 0; i < count; ++i) {
-        insertAt(row + i);
-        for (auto &v : d->checked)
-            v.insert(row + i, false);
-    }
+    insertAt(row, count);
+    for (auto &v : d->checked)
+        v.insert(row, count, false);
     emit rowsChanged(d->rows += count);
     if (d->special >= row)
         setSpecialRow(d->special + count);
@@ -133,18 +133,15 @@ auto SimpleListModelBase::insertRows(int row, int count, const QModelIndex &pare
 auto SimpleListModelBase::removeRows(int row, int count, const QModelIndex &parent) -> bool
 {
     const int to = row + count - 1;
-    int removed = 0;
+    if (count <= 0 || !isValidRow(row) || !isValidRow(to))
+        return false;
     beginRemoveRows(parent, row, to);
-    for (int i = 0; i < count; ++i) {
-        if (removeAt(to - i)) {
-            ++removed;
-            for (auto &v : d->checked)
-                v.removeAt(to - i);
-        }
-    }
-    emit rowsChanged(d->rows -= removed);
+    removeAt(row, count);
+    for (auto &v : d->checked)
+        v.remove(row, count);
+    emit rowsChanged(d->rows -= count);
     if (d->special >= row)
-        setSpecialRow(d->special > to ? d->special - removed : -1);
+        setSpecialRow(d->special > to ? d->special - count : -1);
     endRemoveRows();
     return true;
 }
@@ -331,8 +328,15 @@ auto SimpleListModelBase::remove(const QModelIndexList &indices) -> int
     }
     if (set.empty())
         return 0;
-    for (auto it = set.rbegin(); it != set.rend(); ++it)
-        removeRow(*it);
+    // remove each run of adjacent rows at once from the last one
+    auto it = set.rbegin();
+    while (it != set.rend()) {
+        const int last = *it;
+        int first = last;
+        while (++it != set.rend() && *it == first - 1)
+            --first;
+        removeRows(first, last - first + 1, QModelIndex());
+    }
     return set.size();
 }
 
@@ -46,8 +46,8 @@ protected:
     virtual auto edit(int row, int column, const QVariant &var) -> bool;
 private:
     virtual auto removeAll() -> void = 0;
-    virtual auto insertAt(int row) -> void = 0;
-    virtual auto removeAt(int row) -> bool = 0;
+    virtual auto insertAt(int row, int count) -> void = 0;
+    virtual auto removeAt(int row, int count) -> void = 0;
     virtual auto swapAt(int r1, int r2) -> bool = 0;
     auto columnCount(const QModelIndex &) const -> int final;
     auto rowCount(const QModelIndex &parent = QModelIndex()) const -> int final;
@@ -91,9 +91,10 @@ private:
         std::swap(m_list[r1], m_list[r2]);
         return true;
     }
-    auto insertAt(int row) -> void final { m_list.insert(row, T()); }
-    auto removeAt(int row) -> bool final
-        { return _InRange0(row, m_list.size()) && (m_list.removeAt(row), true); }
+    auto insertAt(int row, int count) -> void final
+        { for (int i = 0; i < count; ++i) m_list.insert(row, T()); }
+    auto removeAt(int row, int count) -> void final
+        { m_list.erase(m_list.begin() + row, m_list.begin() + row + count); }
     auto removeAll() -> void final { m_list.clear(); }
     Container m_list;
 };
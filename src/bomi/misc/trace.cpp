@@ -0,0 +1,227 @@
+#include "trace.hpp"
+#include "log.hpp"
+#include <QThreadPool>
+#include <QElapsedTimer>
+
+DECLARE_LOG_CONTEXT(Trace)
+
+// events kept for each thread, power of 2
+static constexpr uint BufferSize = 8192;
+// recent events can be overwritten while dumping so they are skipped
+static constexpr uint BufferMargin = 256;
+// stalls in this interval in nsec are written in one dump
+static constexpr qint64 StallInterval = 10 * 1000 * 1000 * 1000LL;
+// buffers alive at once, events of more threads are dropped
+static constexpr int MaxBuffers = 64;
+
+struct TraceEvent {
+    const char *name = nullptr;
+    qint64 begin = 0, end = 0, arg = 0;
+    char phase = Trace::Instant;
+};
+
+// events are written only by its owner thread
+// buffer of finished thread is reused by another thread without reset, so
+// events of previous owners stay until overwritten
+struct TraceBuffer {
+    struct Owner { uint from = 0; int tid = 0; QByteArray thread; };
+    QVector<Owner> owners; // ordered by from, under s_mutex
+    QAtomicInteger<uint> head{0};
+    TraceEvent events[BufferSize];
+};
+
+bool Trace::s_enabled = false;
+static QMutex s_mutex; // for s_buffers, s_free, s_stall and owners
+static QVector<TraceBuffer*> s_buffers, s_free;
+static qint64 s_stall = -StallInterval;
+static int s_lastTid = 0;
+static QString s_file;
+static QElapsedTimer s_timer;
+
+// returns buffer to free list when thread finishes
+struct TraceSlot {
+    TraceBuffer *buffer = nullptr;
+    bool full = false;
+    ~TraceSlot()
+    {
+        if (!buffer)
+            return;
+        QMutexLocker locker(&s_mutex);
+        s_free.push_back(buffer);
+    }
+};
+
+static thread_local TraceSlot t_slot;
+
+static auto buffer() -> TraceBuffer*
+{
+    auto &slot = t_slot;
+    if (Q_LIKELY(slot.buffer != nullptr || slot.full))
+        return slot.buffer;
+    const auto thread = QThread::currentThread();
+    auto name = thread->objectName().toUtf8();
+    if (name.isEmpty())
+        name = thread->metaObject()->className();
+    QMutexLocker locker(&s_mutex);
+    TraceBuffer *b = nullptr;
+    if (!s_free.isEmpty()) {
+        b = s_free.takeLast();
+    } else if (s_buffers.size() < MaxBuffers) {
+        b = new TraceBuffer;
+        s_buffers.push_back(b);
+    } else {
+        slot.full = true;
+        return nullptr;
+    }
+    TraceBuffer::Owner owner;
+    owner.from = b->head.load();
+    owner.tid = ++s_lastTid;
+    owner.thread = name;
+    b->owners.push_back(owner);
+    // forget owners whose events are all overwritten
+    while (b->owners.size() > 1 && owner.from - b->owners[1].from >= BufferSize)
+        b->owners.removeFirst();
+    return slot.buffer = b;
+}
+
+SIA escape(const QByteArray &str) -> QByteArray
+{
+    QByteArray ret; ret.reserve(str.size());
+    for (auto c : str) {
+        if (c == '"' || c == '\\')
+            ret += '\\';
+        if (uchar(c) >= 0x20)
+            ret += c;
+    }
+    return ret;
+}
+
+SIA usec(qint64 nsec) -> QByteArray
+{
+    return QByteArray::number(nsec / 1000.0, 'f', 3);
+}
+
+auto Trace::start(const QString &fileName) -> void
+{
+    s_file = QFileInfo(fileName).absoluteFilePath();
+    s_timer.start();
+    s_enabled = true;
+    _Info("Recording trace for %%", s_file);
+}
+
+auto Trace::now() -> qint64
+{
+    return s_timer.nsecsElapsed();
+}
+
+auto Trace::record(Phase phase, const char *name, qint64 begin, qint64 end, qint64 arg) -> void
+{
+    auto b = buffer();
+    if (Q_UNLIKELY(!b))
+        return;
+    const uint head = b->head.load();
+    auto &e = b->events[head & (BufferSize - 1)];
+    e.name = name;
+    e.begin = begin;
+    e.end = end;
+    e.arg = arg;
+    e.phase = phase;
+    b->head.storeRelease(head + 1);
+}
+
+auto Trace::dump(const QString &fileName) -> bool
+{
+    if (!s_enabled) {
+        _Warn("Tracing is not enabled.");
+        return false;
+    }
+    const auto path = fileName.isEmpty() ? s_file : fileName;
+    // owners change when buffer is reused, so take them with head together
+    struct Snapshot { TraceBuffer *buffer; QVector<TraceBuffer::Owner> owners; uint head; };
+    QVector<Snapshot> snapshots;
+    s_mutex.lock();
+    for (auto b : s_buffers)
+        snapshots.push_back({ b, b->owners, b->head.loadAcquire() });
+    s_mutex.unlock();
+
+    QByteArray json;
+    json.reserve(1024 * 1024);
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    int count = 0, threads = 0;
+    QVector<TraceEvent> events;
+    for (auto &s : snapshots) {
+        const uint head = s.head;
+        const uint size = qMin(head, BufferSize - BufferMargin);
+        const uint first = head - size;
+        events.resize(size);
+        for (uint j = 0; j < size; ++j)
+            events[j] = s.buffer->events[(first + j) & (BufferSize - 1)];
+        // skip owners whose events are all overwritten
+        int owner = 0;
+        while (owner + 1 < s.owners.size() && int(s.owners[owner + 1].from - first) <= 0)
+            ++owner;
+        for (int o = owner; o < s.owners.size(); ++o) {
+            if (threads++)
+                json += ',';
+            json += "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"_b
+                    + QByteArray::number(s.owners[o].tid) + ",\"args\":{\"name\":\""_b
+                    + escape(s.owners[o].thread) + "\"}}"_b;
+        }
+        auto tid = QByteArray::number(s.owners[owner].tid);
+        for (uint j = 0; j < size; ++j) {
+            const auto &e = events[j];
+            if (owner + 1 < s.owners.size()
+                    && int(first + j - s.owners[owner + 1].from) >= 0) {
+                while (owner + 1 < s.owners.size()
+                       && int(first + j - s.owners[owner + 1].from) >= 0)
+                    ++owner;
+                tid = QByteArray::number(s.owners[owner].tid);
+            }
+            json += "\n,{\"name\":\""_b + e.name + "\",\"ph\":\""_b + e.phase
+                    + "\",\"pid\":1,\"tid\":"_b + tid + ",\"ts\":"_b + usec(e.begin);
+            if (e.phase == Complete)
+                json += ",\"dur\":"_b + usec(e.end - e.begin);
+            else if (e.phase == Instant)
+                json += ",\"s\":\"t\""_b;
+            json += ",\"args\":{\"value\":"_b + QByteArray::number(e.arg) + "}}"_b;
+        }
+        count += events.size();
+    }
+    json += "\n]}\n";
+
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        _Error("Cannot write trace: %%", path);
+        return false;
+    }
+    file.write(json);
+    _Info("%% events of %% threads dumped to %%", count, threads, path);
+    return true;
+}
+
+auto Trace::stall(const char *name, qint64 gap) -> void
+{
+    if (!s_enabled)
+        return;
+    const auto t = now();
+    record(Instant, name, t, t, gap / 1000);
+    s_mutex.lock();
+    const bool dump = t - s_stall > StallInterval;
+    if (dump)
+        s_stall = t;
+    s_mutex.unlock();
+    if (!dump)
+        return;
+    _Warn("%% stalled for %%ms", name, gap / 1000000);
+    const QFileInfo info(s_file);
+    const auto path = info.absolutePath() % '/'_q % info.completeBaseName()
+            % "-stall-"_a % QString::number(t / 1000000) % ".json"_a;
+    class Job : public QRunnable {
+    public:
+        Job(const QString &path): m_path(path) { }
+        auto run() -> void override { Trace::dump(m_path); }
+    private:
+        QString m_path;
+    };
+    QThreadPool::globalInstance()->start(new Job(path));
+}
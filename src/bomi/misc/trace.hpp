@@ -0,0 +1,47 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// opt-in recording of timestamped events into ring buffer of each thread
+// dumped as Chrome trace event JSON for chrome://tracing or Perfetto
+class Trace {
+public:
+    enum Phase : char { Complete = 'X', Instant = 'i', Counter = 'C' };
+    static auto isEnabled() -> bool { return s_enabled; }
+    // should be called only once on initialization before recording
+    // dump() without file name and stall() write next to fileName
+    static auto start(const QString &fileName) -> void;
+    // in nsec since start()
+    static auto now() -> qint64;
+    // name should live forever like string literal
+    static auto record(Phase phase, const char *name,
+                       qint64 begin, qint64 end, qint64 arg = 0) -> void;
+    static auto instant(const char *name, qint64 arg = 0) -> void
+        { if (s_enabled) { const auto t = now(); record(Instant, name, t, t, arg); } }
+    static auto counter(const char *name, qint64 value) -> void
+        { if (s_enabled) { const auto t = now(); record(Counter, name, t, t, value); } }
+    // dump recent events of all threads
+    static auto dump(const QString &fileName = QString()) -> bool;
+    // record stall which lasted for gap in nsec and dump in background
+    static auto stall(const char *name, qint64 gap) -> void;
+private:
+    static bool s_enabled;
+};
+
+// records complete event from construction to destruction
+class TraceScope {
+public:
+    TraceScope(const char *name, qint64 arg = 0)
+        : m_name(Trace::isEnabled() ? name : nullptr)
+        , m_begin(m_name ? Trace::now() : 0), m_arg(arg) { }
+    ~TraceScope()
+    {
+        if (m_name)
+            Trace::record(Trace::Complete, m_name, m_begin, Trace::now(), m_arg);
+    }
+    auto setArgument(qint64 arg) -> void { m_arg = arg; }
+private:
+    const char *m_name;
+    qint64 m_begin, m_arg;
+};
+
+#endif // TRACE_HPP
@@ -1144,6 +1144,20 @@ auto File::read(char *buffer, qint64 size) -> qint64
     return len_origin - size;
 }
 
+auto File::offset(quint64 at, qint64 *contiguous) const -> qint64
+{
+    if (!isOpen())
+        return -1;
+    quint64 pos = 0;
+    const auto len = UDFFilePos(m_file, at, &pos);
+    if (!len)
+        return -1;
+    pos -= m_file->Partition_Start_Correction * DVD_VIDEO_LB_LEN;
+    if (contiguous)
+        *contiguous = len;
+    return pos;
+}
+
 auto File::close() -> void
 {
     if (m_file)
@@ -215,6 +215,9 @@ public:
     auto read(char *buffer, qint64 size) -> qint64;
     auto read(qint64 size) -> QByteArray;
     auto seek(int64_t lOffset, int whence) -> int64_t;
+    // byte offset in image for pos of file and length of contiguous data
+    // from there, or -1 if pos is out of file
+    auto offset(quint64 pos, qint64 *contiguous = nullptr) const -> qint64;
     auto fileName() const -> QString { return m_fileName; }
 private:
     auto close() -> void;
@@ -1,14 +1,19 @@
 #include "app.hpp"
 #include "mrl.hpp"
+#include "mpv.hpp"
+#include "jrplayer.hpp"
 #include "mainwindow.hpp"
 #include "misc/localconnection.hpp"
 #include "misc/logoption.hpp"
 #include "misc/json.hpp"
 #include "misc/locale.hpp"
 #include "misc/objectstorage.hpp"
+#include "misc/trace.hpp"
 #include "quick/appobject.hpp"
 #include "rootmenu.hpp"
 #include "os/os.hpp"
+#include "subtitle/shadoweffect.hpp"
+#include "subtitle/subtitleglyphrenderer.hpp"
 #include <clocale>
 #include <QStyleFactory>
 #include <QMenuBar>
@@ -42,7 +47,15 @@ auto translator_load(const Locale &locale) -> bool;
 enum class LineCmd {
     Wake, Open, Action, LogLevel, Debug,
     DumpApiTree, DumpActionList, WinAssoc, WinUnassoc, WinAssocDefault,
-    SetSubtitle, AddSubtitle,
+    SetSubtitle, AddSubtitle, Benchmark, Trace
+};
+
+static const QMap<QString, void(*)()> s_benchmarks = {
+    { u"shadow"_q, ShadowEffect::benchmark },
+    { u"glyph"_q, SubtitleGlyphRenderer::benchmark },
+    { u"idle"_q, Mpv::benchmark },
+    { u"jsonrpc"_q, JrPlayer::benchmark },
+    { u"log"_q, Log::benchmark }
 };
 
 static const QCommandLineOption s_dummy{u"__dummy__"_q};
@@ -75,6 +88,8 @@ public:
             args.push_back(QFileInfo(value(LineCmd::AddSubtitle)).absoluteFilePath());
         if (put(LineCmd::Action))
             args.push_back(value(LineCmd::Action));
+        if (put(LineCmd::Trace))
+            args.push_back(QFileInfo(value(LineCmd::Trace)).absoluteFilePath());
         const auto mrl = this->mrl();
         if (!mrl.isEmpty())
             args.push_back(mrl.toString());
@@ -87,6 +102,8 @@ public:
             lv = Log::level(value(LineCmd::LogLevel));
         if (isSet(LineCmd::Debug))
             lv = qMax(lv, Log::Debug);
+        if (isSet(LineCmd::Benchmark))
+            lv = qMax(lv, Log::Info);
         return lv;
     }
     auto mrl() const -> Mrl
@@ -256,6 +273,15 @@ App::App(int &argc, char **argv)
                          u"Dump API structure tree to stdout."_q);
     d->parser->addOption(LineCmd::DumpActionList, u"dump-action-list"_q,
                          u"Dump executable action list to stdout."_q);
+    d->parser->addOption(LineCmd::Benchmark, u"benchmark"_q,
+                         u"Run %1 micro-benchmark and print results. "
+                         "%1 should be one of nexts:\n    "_q
+                         % QStringList(s_benchmarks.keys()).join(u", "_q),
+                         u"name"_q);
+    d->parser->addOption(LineCmd::Trace, u"trace"_q,
+                         u"Record playback trace and write it to %1 on exit and "
+                         "stall. If bomi is already running, write its trace now."_q,
+                         u"file"_q);
 #ifdef Q_OS_WIN
     d->parser->addOption(LineCmd::WinAssoc, u"win-assoc"_q,
                          u"Associate given comma-separated extension list."_q, u"ext"_q);
@@ -319,6 +345,8 @@ App::App(int &argc, char **argv)
 }
 
 App::~App() {
+    if (Trace::isEnabled())
+        Trace::dump();
     setMprisActivated(false);
     delete d->main;
     delete d->mb;
@@ -346,6 +374,13 @@ auto App::executeToQuit() -> bool
         AppObject::dumpInfo();
     if (isSet(LineCmd::DumpActionList))
         RootMenu::dumpInfo();
+    if (isSet(LineCmd::Benchmark)) {
+        const auto run = s_benchmarks.value(d->parser->value(LineCmd::Benchmark));
+        if (run)
+            run();
+        else
+            _Error("Unknown benchmark: %%", d->parser->value(LineCmd::Benchmark));
+    }
     if (isSet(LineCmd::WinAssoc))
         OS::associateFileTypes(nullptr, true, d->parser->value(LineCmd::WinAssoc).split(','_q));
     if (isSet(LineCmd::WinAssocDefault))
@@ -356,6 +391,8 @@ auto App::executeToQuit() -> bool
         done = true;
         _Info("Another instance of bomi is already running. Exit this...");
     }
+    if (!done && d->parser->isSet(LineCmd::Trace))
+        Trace::start(d->parser->value(LineCmd::Trace));
     return done;
 }
 
@@ -380,6 +417,8 @@ auto App::handleMessage(const QByteArray &message) -> void
     switch (type) {
     case CommandLine:
         d->parser->parse(_FromJson<QStringList>(contents));
+        if (d->parser->isSet(LineCmd::Trace))
+            Trace::dump(d->parser->value(LineCmd::Trace));
         runCommands();
         break;
     default:
@@ -1,61 +1,52 @@
 #include "historymodel.hpp"
-#include "mrlstatesqlfield.hpp"
+#include "historywriter.hpp"
+#include "historysearch.hpp"
 #include "misc/log.hpp"
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QQuickItem>
 #include <QSqlQuery>
 #include <QSqlRecord>
+#include <QCache>
 
 DECLARE_LOG_CONTEXT(History)
 
-class Transactor {
-public:
-    Transactor(QSqlDatabase *db, bool commit = true)
-        : m_db(db), m_commit(commit) { start(); }
-    ~Transactor() { done(); }
-    auto start() -> bool
-    {
-        if (m_doing)
-            return true;
-        return m_doing = check(m_db->transaction(), "transaction()"_b);
-    }
-    auto done() -> void
-    {
-        if (!m_doing)
-            return;
-        if (!m_commit || !check(m_db->commit(), "commit()"_b))
-            check(m_db->rollback(), "rollback()"_b);
-        m_doing = false;
-    }
-private:
-    auto check(bool ok, const char *at) const noexcept -> bool
-    {
-        if (!ok)
-            _Error("Error on %%: %%", at, m_db->lastError().text());
-        return ok;
-    }
-    QSqlDatabase *m_db = nullptr;
-    bool m_commit = true, m_doing = false;
+struct HistoryRow {
+    Mrl mrl;
+    QString name;
+    QVariant id, last;
+    int star = 0;
 };
 
-struct RowCache { Mrl mrl; int row = -1; };
+using HistoryPage = QVector<HistoryRow>;
+
+static constexpr int PageSize = 128;
+static constexpr int FilterLimit = 500;
 
 static constexpr auto currentVersion = MrlState::Version;
+// upper 16 bits of user_version, 1 for binary json columns
+static constexpr int currentFormat = 1;
 
 struct HistoryModel::Data {
     HistoryModel *p = nullptr;
     QSqlDatabase db;
-    RowCache rowCache;
     QSqlQuery loader, finder;
     QSqlError error;
     MrlStateSqlFieldList fields, restores, writes;
     MrlState cached;
     const MrlState default_{};
     const QString table = MrlState::table();
+    HistorySearch search{table};
+    HistoryWriter *writer = nullptr;
+    // rows are read by pages with keyset pagination in history order:
+    // starred first and then recent first, ties broken by rowid
+    QCache<int, HistoryPage> pages{16};
+    // rows matching filter ordered by rank
+    QString filter;
+    HistoryPage results;
     bool rememberImage = false, reload = true, visible = false;
     bool mediaTitleLocal = false, mediaTitleUrl = false;
-    int idx_mrl, idx_name, idx_last, idx_device, idx_star, rows = 0;
+    int rows = 0;
     QMutex mutex;
     auto check(const QSqlQuery &query) -> bool
     {
@@ -67,46 +58,266 @@ struct HistoryModel::Data {
     }
     auto upsert(const MrlState *state) -> bool
     {
+        HistoryWriter::upsert(finder, fields, writes, state);
+        return check(finder);
+    }
+    // returns false if state should not be written
+    auto prepareWrite(const MrlState *state) -> bool
+    {
+        if (!writer)
+            return false;
+        if (!rememberImage && state->mrl().isImage())
+            return false;
+        if (!state->mrl().isUnique())
+            return false;
         if (state->mrl() == cached.mrl())
             cached.set_mrl(Mrl());
-        if (!writes.update(finder, state))
-            return check(finder);
-        if (finder.numRowsAffected() > 0)
-            return true;
-        fields.insert(finder, state);
-        return check(finder);
+        return true;
+    }
+    // json columns of version 4 are converted from indented text into binary
+    auto migrate() -> void
+    {
+        QVector<MrlStateSqlField> binaries;
+        for (auto &f : fields) {
+            if (f.isBinary())
+                binaries.push_back(f);
+        }
+        if (binaries.isEmpty())
+            return;
+        auto join = [&] (const QString &pattern, const QString &sep) {
+            return _ToStringList(binaries, [&] (const MrlStateSqlField &f) {
+                return pattern.arg(_L(f.property().name()));
+            }).join(sep);
+        };
+        // read all first not to update rows under the cursor
+        if (!loader.exec("SELECT rowid, "_a % join(u"%1"_q, u","_q) % " FROM "_a
+                         % table % " WHERE "_a
+                         % join(u"typeof(%1) = 'text'"_q, u" OR "_q))) {
+            check(loader);
+            return;
+        }
+        QVector<QVariantList> rows;
+        while (loader.next()) {
+            QVariantList row;
+            row.reserve(binaries.size() + 1);
+            for (int i = 0; i < binaries.size(); ++i)
+                row.push_back(binaries[i].reencode(loader.value(i + 1)));
+            row.push_back(loader.value(0));
+            rows.push_back(row);
+        }
+        loader.finish();
+        if (rows.isEmpty())
+            return;
+        Transactor t(&db);
+        finder.prepare("UPDATE "_a % table % " SET "_a % join(u"%1 = ?"_q, u","_q)
+                       % " WHERE rowid = ?"_a);
+        for (auto &row : rows) {
+            for (int i = 0; i < row.size(); ++i)
+                finder.bindValue(i, row[i]);
+            if (!finder.exec())
+                check(finder);
+        }
+        t.done();
+        _Info("Converted %% entries into binary format.", rows.size());
+        // give back space of indented text
+        finder.exec(u"VACUUM"_q);
+    }
+    auto createIndex() -> void
+    {
+        Transactor t(&db);
+        // history order needs star in 0 or 1 and no null time
+        finder.exec("UPDATE "_a % table % " SET star = 0 WHERE star IS NULL"_a);
+        finder.exec("UPDATE "_a % table % " SET last_played_date_time = 0"
+                    " WHERE last_played_date_time IS NULL"_a);
+        finder.exec("CREATE INDEX IF NOT EXISTS "_a % table % "_order ON "_a
+                    % table % " (star, last_played_date_time)"_a);
+        check(finder);
+        t.done();
+        search.create(db);
     }
     auto load() -> bool
     {
-        const QString select = QString::fromLatin1(
-            "SELECT mrl, name, last_played_date_time, device, star"
-            ", (SELECT COUNT(*) FROM %1) as total FROM %2 ORDER BY "
-            "CASE WHEN star = 1 THEN 1 ELSE 0 END DESC"
-            ", last_played_date_time DESC"
-        );
-        if (!loader.exec(select.arg(table).arg(table))) {
+        // posted changes are already in the database after drain
+        if (writer)
+            writer->drain();
+        QCoreApplication::removePostedEvents(p, HistoryWriter::Written);
+        if (!loader.exec("SELECT COUNT(*) FROM "_a % table)) {
             _Error("%%", loader.lastError().text());
             _Error("Query: %%", loader.lastQuery());
             return false;
         }
-        Q_ASSERT(!loader.isForwardOnly());
         p->beginResetModel();
-        rows = 0;
-        if (loader.next()) {
-            int c = 0;
-            idx_mrl = c++;
-            idx_name = c++;
-            idx_last = c++;
-            idx_device = c++;
-            idx_star = c++;
-            if (_Change(rows,loader.value(c).toInt()))
-                emit p->lengthChanged(rows);
-            loader.seek(-1);
-        }
+        const int prev = rows;
+        rows = loader.next() ? loader.value(0).toInt() : 0;
+        loader.finish();
+        pages.clear();
         error = QSqlError();
         p->endResetModel();
+        if (prev != rows && filter.isEmpty())
+            emit p->lengthChanged(rows);
         reload = false;
-        rowCache = RowCache();
+        return true;
+    }
+    // rows of hits in the same order
+    auto fetch(const QVector<HistorySearchHit> &hits) -> HistoryPage
+    {
+        HistoryPage page;
+        if (hits.isEmpty())
+            return page;
+        QStringList marks;
+        QVariantList ids;
+        for (auto &hit : hits) {
+            marks.push_back(u"?"_q);
+            ids.push_back(hit.id);
+        }
+        HistoryPage rows;
+        select(rows, " WHERE rowid IN ("_a % marks.join(','_q) % ')'_q,
+               ids, u"rowid"_q, ids.size());
+        QHash<qint64, int> found;
+        for (int i = 0; i < rows.size(); ++i)
+            found[rows[i].id.toLongLong()] = i;
+        page.reserve(rows.size());
+        for (auto &hit : hits) {
+            const int idx = found.value(hit.id.toLongLong(), -1);
+            if (idx >= 0)
+                page.push_back(rows[idx]);
+        }
+        return page;
+    }
+    auto applyFilter() -> void
+    {
+        auto results = fetch(search.search(finder, filter, FilterLimit));
+        const int prev = p->rowCount();
+        p->beginResetModel();
+        this->results.swap(results);
+        p->endResetModel();
+        if (prev != p->rowCount())
+            emit p->lengthChanged(p->rowCount());
+    }
+    // updates a row in filter results without changing order
+    auto refresh(const Mrl &mrl) -> void
+    {
+        for (int i = 0; i < results.size(); ++i) {
+            if (results[i].mrl != mrl)
+                continue;
+            HistoryPage page;
+            select(page, u" WHERE rowid = ?"_q, { results[i].id }, u"rowid"_q, 1);
+            if (page.isEmpty())
+                return;
+            results[i] = page.front();
+            emit p->dataChanged(p->index(i, 0), p->index(i, p->columnCount() - 1));
+            return;
+        }
+    }
+    // appends at most limit rows in order of order clause
+    auto select(HistoryPage &page, const QString &where,
+                const QVariantList &values, const QString &order,
+                int limit, int offset = 0) -> void
+    {
+        loader.prepare("SELECT rowid, mrl, name, last_played_date_time, device"
+                       ", star FROM "_a % table % where % " ORDER BY "_a % order
+                       % " LIMIT "_a % _N(limit) % " OFFSET "_a % _N(offset));
+        for (int i = 0; i < values.size(); ++i)
+            loader.bindValue(i, values[i]);
+        if (!loader.exec()) {
+            check(loader);
+            return;
+        }
+        while (loader.next()) {
+            HistoryRow row;
+            row.id = loader.value(0);
+            row.mrl = Mrl::fromUniqueId(loader.value(1).toString(),
+                                        loader.value(4).toString(),
+                                        loader.value(2).toString());
+            row.name = loader.value(2).toString();
+            row.last = loader.value(3);
+            row.star = loader.value(5).toInt();
+            page.push_back(row);
+        }
+        loader.finish();
+    }
+    // rows after key in history order
+    auto after(HistoryPage &page, const HistoryRow &key, int limit) -> void
+    {
+        static const QString order = u"last_played_date_time DESC, rowid DESC"_q;
+        select(page, u" WHERE star = ? AND last_played_date_time <= ?"
+                      " AND (last_played_date_time < ? OR rowid < ?)"_q,
+               { key.star, key.last, key.last, key.id }, order, limit);
+        if (page.size() < limit && key.star)
+            select(page, u" WHERE star = 0"_q, {}, order, limit - page.size());
+    }
+    // rows before key in history order, nearest first
+    auto before(HistoryPage &page, const HistoryRow &key, int limit) -> void
+    {
+        static const QString order = u"last_played_date_time ASC, rowid ASC"_q;
+        select(page, u" WHERE star = ? AND last_played_date_time >= ?"
+                      " AND (last_played_date_time > ? OR rowid > ?)"_q,
+               { key.star, key.last, key.last, key.id }, order, limit);
+        if (page.size() < limit && !key.star)
+            select(page, u" WHERE star = 1"_q, {}, order, limit - page.size());
+    }
+    auto page(int index) -> const HistoryPage*
+    {
+        if (auto page = pages.object(index))
+            return page;
+        auto page = new HistoryPage;
+        page->reserve(PageSize);
+        const int size = qMin(PageSize, rows - index * PageSize);
+        const auto prev = pages.object(index - 1), next = pages.object(index + 1);
+        if (prev && prev->size() == PageSize)
+            after(*page, prev->back(), size);
+        else if (next && !next->isEmpty()) {
+            before(*page, next->front(), size);
+            std::reverse(page->begin(), page->end());
+        } else // jump by scroll bar
+            select(*page, QString(), {}, u"star DESC, last_played_date_time DESC"
+                   ", rowid DESC"_q, size, index * PageSize);
+        pages.insert(index, page);
+        return page;
+    }
+    auto row(int row) -> const HistoryRow*
+    {
+        if (reload)
+            load();
+        if (!filter.isEmpty())
+            return _InRange0(row, results.size()) ? &results[row] : nullptr;
+        if (!_InRange0(row, rows))
+            return nullptr;
+        const auto page = this->page(row / PageSize);
+        if (!page || row % PageSize >= page->size())
+            return nullptr;
+        return &page->at(row % PageSize);
+    }
+    auto apply(const HistoryRowChange &c) -> bool
+    {
+        if (c.to < 0 || c.to > rows - (c.from >= 0))
+            return false;
+        if (!filter.isEmpty()) {
+            // new rows will be found when filter is applied again
+            if (c.from < 0)
+                ++rows;
+            pages.clear();
+            refresh(c.mrl);
+            return true;
+        }
+        if (c.from < 0) {
+            p->beginInsertRows(QModelIndex(), c.to, c.to);
+            ++rows;
+            pages.clear();
+            p->endInsertRows();
+            emit p->lengthChanged(rows);
+            return true;
+        }
+        if (c.from >= rows)
+            return false;
+        if (c.from != c.to) {
+            const int dest = c.to > c.from ? c.to + 1 : c.to;
+            p->beginMoveRows(QModelIndex(), c.from, c.from, QModelIndex(), dest);
+            pages.clear();
+            p->endMoveRows();
+        } else
+            pages.remove(c.to / PageSize);
+        emit p->dataChanged(p->index(c.to, 0), p->index(c.to, p->columnCount() - 1));
         return true;
     }
     auto import(const QVector<MrlState*> &states) -> void
@@ -118,18 +329,12 @@ struct HistoryModel::Data {
         }).join(u", "_q);
 
         finder.exec(u"CREATE TABLE %1 (%2)"_q.arg(table).arg(columns));
+        search.drop(finder);
         for (auto state : states) {
             upsert(state);
             delete state;
         }
     }
-    auto getMrl() const -> Mrl
-    {
-        const auto id = loader.value(idx_mrl).toString();
-        const auto dev = loader.value(idx_device).toString();
-        const auto name = loader.value(idx_name).toString();
-        return Mrl::fromUniqueId(id, dev, name);
-    }
 };
 
 HistoryModel::HistoryModel(QObject *parent)
@@ -166,12 +371,17 @@ HistoryModel::HistoryModel(QObject *parent)
 
     d->finder.exec(u"PRAGMA journal_mode = WAL"_q);
     d->finder.exec(u"PRAGMA user_version"_q);
-    int version = 0;
-    if (d->finder.next())
-        version = d->finder.value(0).toLongLong();
+    int version = 0, format = 0;
+    if (d->finder.next()) {
+        const auto value = d->finder.value(0).toLongLong();
+        version = value & 0xffff;
+        format = value >> 16;
+    }
+    const auto userVersion = "PRAGMA user_version = "_a
+            % _N(currentVersion | (currentFormat << 16));
     if (version < currentVersion) {
         d->import(_ImportMrlStates(version, d->db));
-        d->finder.exec("PRAGMA user_version = "_a % _N(currentVersion));
+        d->finder.exec(userVersion);
     } else {
         auto record = d->db.record(d->table);
         QVector<MrlStateSqlField> lacks;
@@ -188,17 +398,27 @@ HistoryModel::HistoryModel(QObject *parent)
                 d->check(d->finder);
             }
         }
+        if (format < currentFormat) {
+            d->migrate();
+            d->finder.exec(userVersion);
+        }
     }
+    d->createIndex();
     d->load();
+    d->writer = new HistoryWriter(d->db.databaseName(), d->table,
+                                  d->fields, d->writes, this);
 }
 
 HistoryModel::~HistoryModel() {
+    delete d->writer;
     delete d;
 }
 
 auto HistoryModel::rowCount(const QModelIndex &index) const -> int
 {
-    return index.isValid() ? 0 : d->rows;
+    if (index.isValid())
+        return 0;
+    return d->filter.isEmpty() ? d->rows : d->results.size();
 }
 
 auto HistoryModel::columnCount(const QModelIndex &index) const -> int
@@ -214,11 +434,16 @@ auto HistoryModel::getState(MrlState *state) const -> bool
     if (d->restores.isEmpty())
         return true;
     Q_ASSERT(d->restores.isSelectPrepared());
-    if (d->cached.mrl() != state->mrl())
-        return d->restores.select(d->finder, state);
-    for (auto &f : d->restores)
-        f.property().write(state, f.property().read(&d->cached));
-    return true;
+    auto select = [&] () -> bool {
+        if (d->cached.mrl() != state->mrl())
+            return d->restores.select(d->finder, state);
+        for (auto &f : d->restores)
+            f.property().write(state, f.property().read(&d->cached));
+        return true;
+    };
+    if (!d->writer)
+        return select();
+    return d->writer->read(state->mrl(), state, d->restores, select);
 }
 
 auto HistoryModel::find(const Mrl &mrl) const -> const MrlState*
@@ -229,7 +454,9 @@ auto HistoryModel::find(const Mrl &mrl) const -> const MrlState*
     if (d->cached.mrl() == mrl)
         return &d->cached;
     Q_ASSERT(d->fields.isSelectPrepared());
-    if (!d->fields.select(d->finder, &d->cached, mrl))
+    auto select = [&] () { return d->fields.select(d->finder, &d->cached, mrl); };
+    if (!(d->writer ? d->writer->read(mrl, &d->cached, d->fields, select)
+                    : select()))
         return nullptr;
     d->cached.set_mrl(mrl);
     return &d->cached;
@@ -238,52 +465,38 @@ auto HistoryModel::find(const Mrl &mrl) const -> const MrlState*
 auto HistoryModel::play(int row) -> void
 {
     QMutexLocker locker(&d->mutex);
-    if (_InRange0(row, d->rows) && d->loader.seek(row))
-        emit playRequested(d->getMrl());
+    if (const auto r = d->row(row))
+        emit playRequested(r->mrl);
 }
 
 auto HistoryModel::setShowMediaTitleInName(bool local, bool url) -> void
 {
-    if (_Change(d->mediaTitleLocal, local) | _Change(d->mediaTitleUrl, url))
-        d->load();
+    if (_Change(d->mediaTitleLocal, local) | _Change(d->mediaTitleUrl, url)) {
+        if (d->rows > 0)
+            emit dataChanged(index(0, 0), index(d->rows - 1, 0), { NameRole });
+    }
 }
 
 auto HistoryModel::getData(const int row, int role) const -> QVariant
 {
-    if (d->reload) {
-        d->load();
-        d->reload = false;
-    }
-    if (!(0 <= row && row < d->rows))
-        return QVariant();
-    if (!d->loader.seek(row))
+    const auto r = d->row(row);
+    if (!r)
         return QVariant();
-    if (d->rowCache.row != row) {
-        d->rowCache.row = row;
-        d->rowCache.mrl = Mrl();
-    }
-    auto fillMrl = [this] () -> const Mrl& {
-        if (d->rowCache.mrl.isEmpty())
-            d->rowCache.mrl = d->getMrl();
-        return d->rowCache.mrl;
-    };
     switch (role) {
     case NameRole: {
-        fillMrl();
-        if ((d->rowCache.mrl.isLocalFile() && d->mediaTitleLocal)
-                || (d->rowCache.mrl.isRemoteUrl() && d->mediaTitleUrl)) {
-            const auto name = d->loader.value(d->idx_name).toString();
-            if (!name.isEmpty())
-                return name;
+        if ((r->mrl.isLocalFile() && d->mediaTitleLocal)
+                || (r->mrl.isRemoteUrl() && d->mediaTitleUrl)) {
+            if (!r->name.isEmpty())
+                return r->name;
         }
-        return d->rowCache.mrl.displayName();
+        return r->mrl.displayName();
     } case LatestPlayRole: {
-        const auto msecs = d->loader.value(d->idx_last).toLongLong();
+        const auto msecs = r->last.toLongLong();
         return QDateTime::fromMSecsSinceEpoch(msecs).toString(Qt::ISODate);
     } case LocationRole:
-        return fillMrl().toString();
+        return r->mrl.toString();
     case StarRole:
-        return d->loader.value(d->idx_star);
+        return r->star;
     default:
         return QVariant();
     }
@@ -317,61 +530,53 @@ auto HistoryModel::isStarred(int row) const -> bool
 auto HistoryModel::setStarred(int row, bool star) -> void
 {
     QMutexLocker locker(&d->mutex);
-    if (!d->loader.seek(row)) {
-        _Error("Cannot seek to %% row.", row);
+    const auto r = d->row(row);
+    if (!r) {
+        _Error("Cannot find %% row.", row);
         return;
     }
-    const auto mrl = d->getMrl();
-    const auto f = d->fields.field(u"star"_q), m = d->fields.field(u"mrl"_q);
-    Transactor t(&d->db);
-    d->finder.prepare("UPDATE "_a % d->table % " SET star=? WHERE mrl=?"_a);
-    d->finder.bindValue(0, f.sqlData(QVariant::fromValue(star)));
-    d->finder.bindValue(1, m.sqlData(QVariant::fromValue(mrl)));
-    if (!d->finder.exec())
-        qDebug() << d->finder.executedQuery();
-    t.done();
-    update();
+    MrlState state;
+    state.set_mrl(r->mrl);
+    state.set_star(star);
+    if (!d->writer)
+        return;
+    if (state.mrl() == d->cached.mrl())
+        d->cached.set_mrl(Mrl());
+    d->writer->update(&state, u"star"_q);
+    // user is waiting for the row to move
+    d->writer->flush();
 }
 
-auto HistoryModel::update() -> void
+auto HistoryModel::customEvent(QEvent *event) -> void
 {
-    d->load();
+    if (event->type() != HistoryWriter::Written)
+        return;
+    for (auto &change : _GetData<QVector<HistoryRowChange>>(event)) {
+        if (!d->apply(change)) {
+            _Error("Cannot move %% to row %%. Reload all.",
+                   change.mrl.toString(), change.to);
+            d->load();
+            break;
+        }
+    }
 }
 
-auto HistoryModel::update(const MrlState *state, const QString &column, bool reload) -> void
+auto HistoryModel::update(const MrlState *state, const QString &column) -> void
 {
     Q_ASSERT(state);
     QMutexLocker locker(&d->mutex);
-    if (!d->rememberImage && state->mrl().isImage())
-        return;
-    if (!state->mrl().isUnique())
+    if (!d->prepareWrite(state))
         return;
-    const auto f = d->fields.field(column), m = d->fields.field(u"mrl"_q);
-    if (!f.isValid() || !m.isValid())
-        return;
-    Transactor t(&d->db);
-    d->finder.prepare("UPDATE "_a % d->table % " SET "_a % column % "=? WHERE mrl=?"_a);
-    d->finder.bindValue(0, f.sqlData(f.property().read(state)));
-    d->finder.bindValue(1, m.sqlData(m.property().read(state)));
-    d->finder.exec();
-    t.done();
-    if (reload)
-        update();
+    d->writer->update(state, column);
 }
 
-auto HistoryModel::update(const MrlState *state, bool reload) -> void
+auto HistoryModel::update(const MrlState *state) -> void
 {
     Q_ASSERT(state);
     QMutexLocker locker(&d->mutex);
-    if (!d->rememberImage && state->mrl().isImage())
+    if (!d->prepareWrite(state))
         return;
-    if (!state->mrl().isUnique())
-        return;
-    Transactor t(&d->db);
-    d->upsert(state);
-    t.done();
-    if (reload)
-        update();
+    d->writer->upsert(state);
 }
 
 auto HistoryModel::setRememberImage(bool on) -> void
@@ -409,10 +614,48 @@ auto HistoryModel::setPropertiesToRestore(const QStringList &list) -> void
 auto HistoryModel::clear() -> void
 {
     QMutexLocker locker(&d->mutex);
+    if (d->writer)
+        d->writer->drain();
     Transactor t(&d->db);
     d->loader.exec("DELETE FROM "_a % d->table % " WHERE star != 1 OR star IS NULL"_a);
+    d->search.prune(d->loader);
     t.done();
     d->load();
+    if (!d->filter.isEmpty())
+        d->applyFilter();
+}
+
+auto HistoryModel::filter() const -> QString
+{
+    return d->filter;
+}
+
+auto HistoryModel::setFilter(const QString &filter) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    const auto text = filter.trimmed();
+    if (!_Change(d->filter, text))
+        return;
+    if (d->filter.isEmpty()) {
+        // rows and pages are kept up to date while filtering
+        const int prev = d->results.size();
+        beginResetModel();
+        d->results.clear();
+        endResetModel();
+        if (prev != d->rows)
+            emit lengthChanged(d->rows);
+    } else
+        d->applyFilter();
+    emit filterChanged(d->filter);
+}
+
+auto HistoryModel::search(const QString &text, int limit) const -> QStringList
+{
+    QMutexLocker locker(&d->mutex);
+    QStringList list;
+    for (auto &row : d->fetch(d->search.search(d->finder, text, limit)))
+        list.push_back(row.mrl.toString());
+    return list;
 }
 
 auto HistoryModel::isVisible() const -> bool
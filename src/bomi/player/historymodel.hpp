@@ -9,6 +9,7 @@ class HistoryModel: public QAbstractTableModel {
     Q_OBJECT
     Q_PROPERTY(bool visible READ isVisible WRITE setVisible NOTIFY visibleChanged)
     Q_PROPERTY(int length READ rowCount NOTIFY lengthChanged)
+    Q_PROPERTY(QString filter READ filter WRITE setFilter NOTIFY filterChanged)
 public:
     enum Role {NameRole = Qt::UserRole + 1, LatestPlayRole, LocationRole, StarRole};
     HistoryModel(QObject *parent = nullptr);
@@ -20,26 +21,33 @@ public:
     auto roleNames() const -> QHash<int, QByteArray>;
     auto find(const Mrl &mrl) const -> const MrlState*;
     auto getState(MrlState *state) const -> bool;
-    auto update(const MrlState *state, const QString &column, bool reload) -> void;
-    auto update(const MrlState *state, bool reload) -> void;
+    // rows are updated when the write is committed
+    auto update(const MrlState *state, const QString &column) -> void;
+    auto update(const MrlState *state) -> void;
     auto setShowMediaTitleInName(bool local, bool url) -> void;
     auto setRememberImage(bool on) -> void;
     auto setPropertiesToRestore(const QStringList &properties) -> void;
     auto isRestorable(const char *name) const -> bool;
     auto clear() -> void;
+    // shows only rows matching full-text search ranked by relevance
+    auto filter() const -> QString;
+    auto setFilter(const QString &filter) -> void;
     auto isVisible() const -> bool;
     auto setVisible(bool visible) -> void;
-    auto update() -> void;
     auto toggle() -> void { setVisible(!isVisible()); }
     Q_INVOKABLE bool isStarred(int row) const;
     Q_INVOKABLE void setStarred(int row, bool star);
     Q_INVOKABLE void play(int row);
+    // locations of ranked matches
+    Q_INVOKABLE QStringList search(const QString &text, int limit) const;
 signals:
     void playRequested(const Mrl &mrl);
     void changeVisibilityRequested(bool visible);
     void visibleChanged(bool visible);
     void lengthChanged(int length);
+    void filterChanged(const QString &filter);
 private:
+    auto customEvent(QEvent *event) -> void final;
     auto getData(int row, int role) const -> QVariant;
     struct Data;
     Data *d;
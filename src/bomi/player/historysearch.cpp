@@ -0,0 +1,173 @@
+#include "historysearch.hpp"
+#include "historywriter.hpp"
+#include "mrl.hpp"
+#include "misc/log.hpp"
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+DECLARE_LOG_CONTEXT(History)
+
+// rows played more recently win when too many rows match
+static constexpr int MaxCandidates = 1000;
+// weights of location, display name and media title
+static const double Weights[] = { 1.0, 2.0, 2.0 };
+
+SIA check(const QSqlQuery &query) -> bool
+{
+    if (!query.lastError().isValid())
+        return true;
+    _Error("Error on query: %% for %%"
+           , query.lastError().text(), query.lastQuery());
+    return false;
+}
+
+HistorySearch::HistorySearch(const QString &table)
+    : m_table(table), m_fts(table % "_fts"_a) { }
+
+auto HistorySearch::create(QSqlDatabase &db) -> bool
+{
+    QSqlQuery query(db);
+    query.prepare(u"SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?"_q);
+    query.bindValue(0, m_fts);
+    if (query.exec() && query.next())
+        return true;
+    query.finish();
+
+    const auto create = "CREATE VIRTUAL TABLE "_a % m_fts
+            % " USING fts4(location, name, title, prefix=\"2,3\""_a;
+    if (!query.exec(create % ", tokenize=unicode61)"_a)) {
+        _Info("unicode61 tokenizer is not available: %%",
+              query.lastError().text());
+        if (!query.exec(create % ')'_q))
+            return check(query);
+    }
+
+    Transactor t(&db);
+    QSqlQuery insert(db);
+    if (!query.exec("SELECT rowid, mrl, device, name FROM "_a % m_table))
+        return check(query);
+    int count = 0;
+    while (query.next()) {
+        const auto id = query.value(1).toString();
+        const auto title = query.value(3).toString();
+        const auto mrl = Mrl::fromUniqueId(id, query.value(2).toString(), title);
+        if (this->insert(insert, query.value(0), id, mrl.displayName(), title))
+            ++count;
+    }
+    _Info("Indexed %% entries for search.", count);
+    return true;
+}
+
+auto HistorySearch::drop(QSqlQuery &query) -> void
+{
+    query.exec("DROP TABLE IF EXISTS "_a % m_fts);
+}
+
+auto HistorySearch::insert(QSqlQuery &query, const QVariant &id,
+                           const QString &location, const QString &name,
+                           const QString &title) -> bool
+{
+    query.prepare("INSERT INTO "_a % m_fts
+                  % " (docid, location, name, title) VALUES (?, ?, ?, ?)"_a);
+    query.bindValue(0, id);
+    query.bindValue(1, location);
+    query.bindValue(2, name);
+    query.bindValue(3, title);
+    return query.exec() || check(query);
+}
+
+auto HistorySearch::index(QSqlQuery &query, const Mrl &mrl,
+                          const QString &title) -> bool
+{
+    const auto location = mrl.toString();
+    query.prepare("SELECT h.rowid, f.title FROM "_a % m_table % " h LEFT JOIN "_a
+                  % m_fts % " f ON f.docid = h.rowid WHERE h.mrl = ?"_a);
+    query.bindValue(0, location);
+    if (!query.exec() || !query.next())
+        return check(query);
+    const auto id = query.value(0);
+    const bool exists = !query.value(1).isNull();
+    // most of upserts only change playback state
+    if (exists && query.value(1).toString() == title)
+        return true;
+    query.finish();
+    if (exists) {
+        query.prepare("DELETE FROM "_a % m_fts % " WHERE docid = ?"_a);
+        query.bindValue(0, id);
+        if (!query.exec())
+            return check(query);
+    }
+    return insert(query, id, location, mrl.displayName(), title);
+}
+
+auto HistorySearch::prune(QSqlQuery &query) -> void
+{
+    query.exec("DELETE FROM "_a % m_fts % " WHERE docid NOT IN (SELECT rowid FROM "_a
+               % m_table % ')'_q);
+    check(query);
+}
+
+auto HistorySearch::match(const QString &text) -> QString
+{
+    QStringList terms;
+    for (auto term : text.split(QRegularExpression(u"\\s+"_q), QString::SkipEmptyParts)) {
+        term.remove('"'_q);
+        term.remove('*'_q);
+        if (!term.isEmpty())
+            terms.push_back('"'_q % term % "*\""_a);
+    }
+    return terms.join(' '_q);
+}
+
+auto HistorySearch::search(QSqlQuery &query, const QString &text,
+                           int limit) const -> QVector<HistorySearchHit>
+{
+    QVector<HistorySearchHit> hits;
+    const auto match = HistorySearch::match(text);
+    if (match.isEmpty() || limit <= 0)
+        return hits;
+    query.prepare("SELECT h.rowid, matchinfo("_a % m_fts % ", 'pcnx') FROM "_a
+                  % m_fts % " JOIN "_a % m_table % " h ON h.rowid = "_a % m_fts
+                  % ".docid WHERE "_a % m_fts % " MATCH ?"
+                  " ORDER BY h.last_played_date_time DESC LIMIT "_a % _N(MaxCandidates));
+    query.bindValue(0, match);
+    if (!query.exec()) {
+        check(query);
+        return hits;
+    }
+    while (query.next()) {
+        // p, c, n and then 3 values of each phrase and column:
+        // hits in this row, hits in all rows, rows with hits
+        const auto blob = query.value(1).toByteArray();
+        auto info = reinterpret_cast<const quint32*>(blob.constData());
+        const int size = blob.size() / sizeof(quint32);
+        if (size < 3)
+            continue;
+        const int phrases = info[0], columns = info[1];
+        const double rows = info[2];
+        if (size < 3 + phrases * columns * 3)
+            continue;
+        HistorySearchHit hit;
+        hit.id = query.value(0);
+        for (int p = 0; p < phrases; ++p) {
+            for (int c = 0; c < columns && c < 3; ++c) {
+                const auto x = info + 3 + (p * columns + c) * 3;
+                if (!x[0])
+                    continue;
+                const double tf = x[0], df = x[2];
+                const double idf = std::log(1.0 + (rows - df + 0.5) / (df + 0.5));
+                hit.score += Weights[c] * idf * tf / (tf + 1.2);
+            }
+        }
+        hits.push_back(hit);
+    }
+    query.finish();
+    // stable to keep recently played ones first for same score
+    std::stable_sort(hits.begin(), hits.end(), [] (const HistorySearchHit &lhs,
+                                                   const HistorySearchHit &rhs)
+        { return lhs.score > rhs.score; });
+    if (hits.size() > limit)
+        hits.resize(limit);
+    return hits;
+}
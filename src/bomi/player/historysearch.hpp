@@ -0,0 +1,36 @@
+#ifndef HISTORYSEARCH_HPP
+#define HISTORYSEARCH_HPP
+
+class Mrl;                              class QSqlQuery;
+class QSqlDatabase;
+
+struct HistorySearchHit {
+    QVariant id; // rowid of history
+    double score = 0.0;
+};
+
+// full-text index of location, display name and media title in history
+// kept in fts4 table whose docid is rowid of history table
+class HistorySearch {
+public:
+    HistorySearch(const QString &table = QString());
+    auto table() const -> QString { return m_fts; }
+    // creates index and fills it from history if it does not exist yet
+    auto create(QSqlDatabase &db) -> bool;
+    auto drop(QSqlQuery &query) -> void;
+    // mrl should be in history already
+    auto index(QSqlQuery &query, const Mrl &mrl, const QString &title) -> bool;
+    // removes entries which are not in history anymore
+    auto prune(QSqlQuery &query) -> void;
+    // hits sorted by score
+    auto search(QSqlQuery &query, const QString &text,
+                int limit) const -> QVector<HistorySearchHit>;
+    // converts user input into prefix query with all terms
+    static auto match(const QString &text) -> QString;
+private:
+    auto insert(QSqlQuery &query, const QVariant &id, const QString &location,
+                const QString &name, const QString &title) -> bool;
+    QString m_table, m_fts;
+};
+
+#endif // HISTORYSEARCH_HPP
@@ -0,0 +1,345 @@
+#include "historywriter.hpp"
+#include "historysearch.hpp"
+#include "mrlstate.hpp"
+#include "misc/log.hpp"
+#include "misc/dataevent.hpp"
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QElapsedTimer>
+
+DECLARE_LOG_CONTEXT(History)
+
+auto Transactor::start() -> bool
+{
+    if (m_doing)
+        return true;
+    return m_doing = check(m_db->transaction(), "transaction()"_b);
+}
+
+auto Transactor::done() -> void
+{
+    if (!m_doing)
+        return;
+    if (!m_commit || !check(m_db->commit(), "commit()"_b))
+        check(m_db->rollback(), "rollback()"_b);
+    m_doing = false;
+}
+
+auto Transactor::check(bool ok, const char *at) const noexcept -> bool
+{
+    if (!ok)
+        _Error("Error on %%: %%", at, m_db->lastError().text());
+    return ok;
+}
+
+/******************************************************************************/
+
+struct PendingWrite {
+    QSharedPointer<MrlState> state; // whole state to upsert
+    QMap<QString, QVariant> columns; // property values to update after upsert
+};
+
+using PendingMap = QMap<Mrl, PendingWrite>;
+
+struct HistoryWriter::Data {
+    QString path, table;
+    MrlStateSqlFieldList fields, writes;
+    HistorySearch search;
+    QObject *receiver = nullptr;
+    mutable QMutex mutex;
+    QWaitCondition wait, drained;
+    PendingMap queue, writing;
+    QElapsedTimer since;
+    int interval = 500;
+    bool quit = false, flush = false;
+    HistoryWriterStats stats;
+
+    auto find(const Mrl &mrl) const -> const PendingWrite*
+    {
+        auto it = queue.constFind(mrl);
+        if (it != queue.constEnd())
+            return &*it;
+        it = writing.constFind(mrl);
+        return it != writing.constEnd() ? &*it : nullptr;
+    }
+    auto enqueue(const Mrl &mrl) -> PendingWrite&
+    {
+        ++stats.requests;
+        if (queue.isEmpty())
+            since.start();
+        auto it = queue.find(mrl);
+        if (it != queue.end()) {
+            ++stats.coalesced;
+            return *it;
+        }
+        // start from entry in flight, so that readers never go backward
+        auto &pending = queue[mrl];
+        if (const auto writing = this->writing.value(mrl).state) {
+            pending.state.reset(new MrlState);
+            pending.state->copyFrom(writing.data());
+        }
+        return pending;
+    }
+    auto check(const QSqlQuery &query) -> bool
+    {
+        if (!query.lastError().isValid())
+            return true;
+        _Error("Error on query: %% for %%"
+               , query.lastError().text(), query.lastQuery());
+        return false;
+    }
+    // counts rows before mrl in history order, which is covered by index
+    // on (star, last_played_date_time) with implicit rowid
+    auto row(QSqlQuery &query, const Mrl &mrl) -> int
+    {
+        const auto m = fields.field(u"mrl"_q);
+        query.prepare("SELECT rowid, star, last_played_date_time FROM "_a
+                      % table % " WHERE mrl = ?"_a);
+        query.bindValue(0, m.sqlData(QVariant::fromValue(mrl)));
+        if (!query.exec() || !query.next())
+            return -1;
+        const auto id = query.value(0), star = query.value(1).toInt();
+        const auto last = query.value(2);
+        query.prepare("SELECT (SELECT COUNT(*) FROM "_a % table
+                      % " WHERE star > ?) + (SELECT COUNT(*) FROM "_a % table
+                      % " WHERE star = ? AND last_played_date_time >= ?"_a
+                      % " AND (last_played_date_time > ? OR rowid > ?))"_a);
+        query.bindValue(0, star);
+        query.bindValue(1, star);
+        query.bindValue(2, last);
+        query.bindValue(3, last);
+        query.bindValue(4, id);
+        if (!query.exec() || !query.next()) {
+            check(query);
+            return -1;
+        }
+        return query.value(0).toInt();
+    }
+    auto write(QSqlQuery &query, const Mrl &mrl,
+               const PendingWrite &pending) -> void
+    {
+        if (pending.state) {
+            const auto state = pending.state.data();
+            if (upsert(query, fields, writes, state))
+                search.index(query, mrl, state->name());
+        }
+        const auto m = fields.field(u"mrl"_q);
+        for (auto it = pending.columns.begin(); it != pending.columns.end(); ++it) {
+            const auto f = fields.field(it.key());
+            query.prepare("UPDATE "_a % table % " SET "_a % it.key()
+                          % "=? WHERE mrl=?"_a);
+            query.bindValue(0, f.sqlData(it.value()));
+            query.bindValue(1, m.sqlData(QVariant::fromValue(mrl)));
+            if (query.exec() && it.key() == "name"_a)
+                search.index(query, mrl, it.value().toString());
+            check(query);
+        }
+    }
+};
+
+HistoryWriter::HistoryWriter(const QString &path, const QString &table,
+                             const MrlStateSqlFieldList &fields,
+                             const MrlStateSqlFieldList &writes,
+                             QObject *receiver)
+    : d(new Data)
+{
+    d->path = path;
+    d->table = table;
+    d->search = HistorySearch(table);
+    d->fields = fields;
+    d->writes = writes;
+    d->receiver = receiver;
+    start();
+}
+
+HistoryWriter::~HistoryWriter()
+{
+    d->mutex.lock();
+    d->quit = true;
+    d->mutex.unlock();
+    d->wait.wakeAll();
+    wait();
+    delete d;
+}
+
+auto HistoryWriter::upsert(QSqlQuery &query, MrlStateSqlFieldList &fields,
+                           MrlStateSqlFieldList &writes,
+                           const MrlState *state) -> bool
+{
+    if (!writes.update(query, state))
+        return false;
+    if (query.numRowsAffected() > 0)
+        return true;
+    return fields.insert(query, state);
+}
+
+auto HistoryWriter::upsert(const MrlState *state) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    auto &pending = d->enqueue(state->mrl());
+    if (!pending.state)
+        pending.state.reset(new MrlState);
+    pending.state->copyFrom(state);
+    // whole state has the latest values of written columns, but columns
+    // excluded from update of existing row must be written by themselves
+    for (auto it = pending.columns.begin(); it != pending.columns.end();) {
+        if (d->writes.field(it.key()).isValid())
+            it = pending.columns.erase(it);
+        else
+            ++it;
+    }
+    d->wait.wakeAll();
+}
+
+auto HistoryWriter::update(const MrlState *state, const QString &column) -> void
+{
+    const auto f = d->fields.field(column);
+    if (!f.isValid())
+        return;
+    const auto value = f.property().read(state);
+    QMutexLocker locker(&d->mutex);
+    auto &pending = d->enqueue(state->mrl());
+    if (pending.state)
+        f.property().write(pending.state.data(), value);
+    // upsert of whole state may skip this column for existing row
+    pending.columns[column] = value;
+    d->wait.wakeAll();
+}
+
+auto HistoryWriter::pending(const Mrl &mrl) const -> Pending
+{
+    QMutexLocker locker(&d->mutex);
+    const auto pending = d->find(mrl);
+    if (!pending)
+        return None;
+    return pending->state ? Whole : Columns;
+}
+
+auto HistoryWriter::read(const Mrl &mrl, QObject *state,
+                         const MrlStateSqlFieldList &fields,
+                         const std::function<bool(void)> &select) const -> bool
+{
+    QMutexLocker locker(&d->mutex);
+    // commit is finished before entry in flight is removed under this lock,
+    // so select() sees either committed row or pending one
+    auto overlay = [&] (const PendingWrite *pending) {
+        if (pending->state) {
+            for (auto &f : fields)
+                f.property().write(state, f.property().read(pending->state.data()));
+        }
+        for (auto &f : fields) {
+            const auto it = pending->columns.find(_L(f.property().name()));
+            if (it != pending->columns.end())
+                f.property().write(state, *it);
+        }
+    };
+    auto find = [&] (const PendingMap &map) -> const PendingWrite* {
+        const auto it = map.constFind(mrl);
+        return it != map.constEnd() ? &*it : nullptr;
+    };
+    const auto writing = find(d->writing), queued = find(d->queue);
+    bool found = false;
+    if (!(queued && queued->state) && !(writing && writing->state))
+        found = select();
+    if (writing)
+        overlay(writing);
+    if (queued)
+        overlay(queued);
+    // columns alone cannot make a row
+    return found || (writing && writing->state) || (queued && queued->state);
+}
+
+auto HistoryWriter::drain() -> void
+{
+    QMutexLocker locker(&d->mutex);
+    while (!d->queue.isEmpty() || !d->writing.isEmpty()) {
+        d->flush = true;
+        d->wait.wakeAll();
+        d->drained.wait(&d->mutex);
+    }
+}
+
+auto HistoryWriter::flush() -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->flush = true;
+    d->wait.wakeAll();
+}
+
+auto HistoryWriter::flushInterval() const -> int
+{
+    QMutexLocker locker(&d->mutex);
+    return d->interval;
+}
+
+auto HistoryWriter::setFlushInterval(int msec) -> void
+{
+    QMutexLocker locker(&d->mutex);
+    d->interval = msec;
+    d->wait.wakeAll();
+}
+
+auto HistoryWriter::stats() const -> HistoryWriterStats
+{
+    QMutexLocker locker(&d->mutex);
+    return d->stats;
+}
+
+auto HistoryWriter::run() -> void
+{
+    const auto name = u"history-writer"_q;
+    {
+        auto db = QSqlDatabase::addDatabase(u"QSQLITE"_q, name);
+        db.setDatabaseName(d->path);
+        if (!db.open())
+            _Error("Error: %%. Couldn't open database for writing.",
+                   db.lastError().text());
+        QSqlQuery query(db), ranker(db);
+        // WAL with normal sync never corrupts database and avoids fsync
+        // on every commit which stalls on slow storage
+        query.exec(u"PRAGMA synchronous = NORMAL"_q);
+        d->fields.prepareInsert(d->table);
+        d->writes.prepareUpdate(d->table, d->fields.field(u"mrl"_q));
+
+        QMutexLocker locker(&d->mutex);
+        for (;;) {
+            while (!d->quit && d->queue.isEmpty())
+                d->wait.wait(&d->mutex);
+            for (;;) {
+                const int remain = d->interval - d->since.elapsed();
+                if (d->quit || d->flush || remain <= 0)
+                    break;
+                d->wait.wait(&d->mutex, remain);
+            }
+            d->flush = false;
+            if (d->queue.isEmpty() && d->quit)
+                break;
+            d->writing.swap(d->queue);
+            locker.unlock();
+
+            QVector<HistoryRowChange> changes;
+            changes.reserve(d->writing.size());
+            if (db.isOpen()) {
+                Transactor t(&db);
+                for (auto it = d->writing.cbegin(); it != d->writing.cend(); ++it) {
+                    HistoryRowChange change;
+                    change.mrl = it.key();
+                    change.from = d->row(ranker, it.key());
+                    d->write(query, it.key(), *it);
+                    change.to = d->row(ranker, it.key());
+                    if (change.from >= 0 || change.to >= 0)
+                        changes.push_back(change);
+                }
+            }
+
+            locker.relock();
+            ++d->stats.batches;
+            d->stats.rows += d->writing.size();
+            d->writing.clear();
+            d->drained.wakeAll();
+            _PostEvent(d->receiver, Written, changes);
+        }
+    }
+    QSqlDatabase::removeDatabase(name);
+}
@@ -0,0 +1,69 @@
+#ifndef HISTORYWRITER_HPP
+#define HISTORYWRITER_HPP
+
+#include "mrlstatesqlfield.hpp"
+#include "mrl.hpp"
+
+class MrlState;
+
+class Transactor {
+public:
+    Transactor(QSqlDatabase *db, bool commit = true)
+        : m_db(db), m_commit(commit) { start(); }
+    ~Transactor() { done(); }
+    auto start() -> bool;
+    auto done() -> void;
+private:
+    auto check(bool ok, const char *at) const noexcept -> bool;
+    QSqlDatabase *m_db = nullptr;
+    bool m_commit = true, m_doing = false;
+};
+
+// row of an mrl in history order before and after a write, -1 if none
+// history order is starred first and then recent first, ties by rowid
+struct HistoryRowChange {
+    Mrl mrl;
+    int from = -1, to = -1;
+};
+
+struct HistoryWriterStats {
+    quint64 requests = 0, coalesced = 0, batches = 0, rows = 0;
+};
+
+// writes history in its own thread and connection
+// requests for same mrl are coalesced and written in a transaction
+// at most flushInterval() msec after first pending request
+// after each commit, Written event is posted to receiver with
+// QVector<HistoryRowChange> in the order of writes
+class HistoryWriter : public QThread {
+public:
+    static constexpr int Written = QEvent::User + 1;
+    enum Pending { None, Columns, Whole };
+    HistoryWriter(const QString &path, const QString &table,
+                  const MrlStateSqlFieldList &fields,
+                  const MrlStateSqlFieldList &writes, QObject *receiver);
+    // remaining requests are written before return
+    ~HistoryWriter();
+    auto upsert(const MrlState *state) -> void;
+    auto update(const MrlState *state, const QString &column) -> void;
+    auto pending(const Mrl &mrl) const -> Pending;
+    // runs select() and puts pending values of fields on state atomically
+    // with respect to commits, so readers always see their own writes
+    auto read(const Mrl &mrl, QObject *state, const MrlStateSqlFieldList &fields,
+              const std::function<bool(void)> &select) const -> bool;
+    // blocks until all pending requests are written
+    auto drain() -> void;
+    // starts writing pending requests without waiting for interval
+    auto flush() -> void;
+    auto flushInterval() const -> int;
+    auto setFlushInterval(int msec) -> void;
+    auto stats() const -> HistoryWriterStats;
+    static auto upsert(QSqlQuery &query, MrlStateSqlFieldList &fields,
+                       MrlStateSqlFieldList &writes, const MrlState *state) -> bool;
+private:
+    auto run() -> void override;
+    struct Data;
+    Data *d;
+};
+
+#endif // HISTORYWRITER_HPP
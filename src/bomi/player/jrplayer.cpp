@@ -1,9 +1,38 @@
 #include "jrplayer.hpp"
 #include "quick/appobject.hpp"
 #include "json/jrcommon.hpp"
+#include "json/jrserver.hpp"
+#include "json/jrclient.hpp"
 #include "misc/jsonstorage.hpp"
+#include <QBuffer>
+#include <QTcpSocket>
+#include <QEventLoop>
+
+DECLARE_LOG_CONTEXT(JSON-RPC)
+
+// cache is dropped at once when it grows over this, e.g. by indices of list
+static constexpr int MaxRoutes = 1024;
+
+struct JrOverload {
+    QMetaMethod method;
+    QVector<int> types;
+    QVector<QString> names;
+};
+
+// what a method string of request points to
+struct JrRoute {
+    enum Kind { Property, Methods, Length };
+    Kind kind = Property;
+    QPointer<QObject> object;
+    QMetaProperty property;
+    QByteArray list;
+    QVector<JrOverload> overloads;
+    // objects and notify signals of properties on the path
+    QVector<QPair<QObject*, int>> watches;
+};
 
 struct JrPlayer::Data {
+    JrPlayer *p = nullptr;
     AppObject app;
     QMetaObject *mo = nullptr;
     PlayEngine *engine;
@@ -11,8 +40,192 @@ struct JrPlayer::Data {
     HistoryModel *history;
     WindowObject *window;
 
+    QHash<QString, JrRoute> routes;
+    QSet<QPair<QObject*, int>> watched;
+    QVector<QMetaObject::Connection> connections;
+    QMetaMethod invalidate;
+
     using ParamArray = std::array<QVariant, 10>;
 
+    // false if path cannot be followed; cacheable is false if some step
+    // on the path may change without notification
+    auto resolve(const QString &jrMethod, JrRoute &route, bool &cacheable) -> bool
+    {
+        QObject *object = &app;
+        int pos = 0;
+        if (jrMethod.startsWith("App."_a))
+            pos = 4;
+        auto watch = [&] (QObject *object, int idx) {
+            route.watches.push_back(qMakePair(object, -1));
+            if (idx < 0) {
+                cacheable = false;
+                return;
+            }
+            const auto property = object->metaObject()->property(idx);
+            if (property.isConstant())
+                return;
+            if (property.hasNotifySignal())
+                route.watches.push_back(qMakePair(object, property.notifySignalIndex()));
+            else
+                cacheable = false;
+        };
+        while (pos < jrMethod.size()) {
+            const int next = jrMethod.indexOf('.'_q, pos);
+            if (next > pos) {
+                const auto name = jrMethod.midRef(pos, next - pos).toUtf8();
+                pos = next + 1;
+                const auto mo = object->metaObject();
+                const int left = name.indexOf('[');
+                if (left > 0) {
+                    const auto listName = name.left(left);
+                    QQmlListReference list(object, listName);
+                    const int right = name.indexOf(']', left);
+                    if (!list.isValid() || right < 0)
+                        return false;
+                    bool ok = false;
+                    const int idx = name.mid(left + 1, right - (left + 1)).toInt(&ok);
+                    const auto obj = list.at(idx);
+                    if (!ok || !obj)
+                        return false;
+                    watch(object, mo->indexOfProperty(listName));
+                    object = obj;
+                    continue;
+                }
+                const int idx = mo->indexOfProperty(name);
+                const auto p = object->property(name);
+                if (auto obj = p.value<QObject*>()) {
+                    watch(object, idx);
+                    object = obj;
+                    continue;
+                }
+                QQmlListReference list(object, name);
+                if (!list.isValid() || jrMethod.midRef(pos) != "length"_a)
+                    return false;
+                route.kind = JrRoute::Length;
+                route.object = object;
+                route.list = name;
+                route.watches.push_back(qMakePair(object, -1));
+                return true;
+            }
+            const auto name = jrMethod.midRef(pos).toUtf8();
+            pos = jrMethod.size();
+            if (name.isEmpty())
+                return false;
+
+            route.object = object;
+            route.watches.push_back(qMakePair(object, -1));
+            const auto mo = object->metaObject();
+            const int idx = mo->indexOfProperty(name);
+            if (idx >= 0) {
+                route.kind = JrRoute::Property;
+                route.property = mo->property(idx);
+                return true;
+            }
+            route.kind = JrRoute::Methods;
+            for (int i = 0; i < mo->methodCount(); ++i) {
+                const auto method = mo->method(i);
+                if (method.name() != name)
+                    continue;
+                JrOverload overload;
+                overload.method = method;
+                overload.types.resize(method.parameterCount());
+                for (int j = 0; j < method.parameterCount(); ++j)
+                    overload.types[j] = method.parameterType(j);
+                for (auto &param : method.parameterNames())
+                    overload.names.push_back(_L(param));
+                route.overloads.push_back(overload);
+            }
+            // no need to remember what does not exist
+            if (route.overloads.isEmpty())
+                cacheable = false;
+            return true;
+        }
+        return false;
+    }
+
+    static auto signal(const QPair<QObject*, int> &watch) -> QMetaMethod
+    {
+        if (watch.second < 0)
+            return QMetaMethod::fromSignal(&QObject::destroyed);
+        return watch.first->metaObject()->method(watch.second);
+    }
+
+    auto cache(const QString &jrMethod, const JrRoute &route) -> void
+    {
+        if (routes.size() >= MaxRoutes)
+            clear();
+        for (auto &w : route.watches) {
+            if (watched.contains(w))
+                continue;
+            watched.insert(w);
+            connections.push_back(QObject::connect(w.first, signal(w), p, invalidate));
+        }
+        routes.insert(jrMethod, route);
+    }
+
+    auto clear() -> void
+    {
+        for (auto &c : connections)
+            QObject::disconnect(c);
+        connections.clear();
+        watched.clear();
+        routes.clear();
+    }
+
+    auto call(const JrRoute &route, const JrRequest &request) -> JrResponse
+    {
+        const auto jrParams = request.params();
+        auto error = [&] (JrError e) { return _JrErrorResponse(request.id(), e); };
+        QObject *object = route.object;
+        if (!object)
+            return error(JrError::MethodNotFound);
+        switch (route.kind) {
+        case JrRoute::Length:
+            return { request, QQmlListReference(object, route.list).count() };
+        case JrRoute::Property: {
+            const auto &p = route.property;
+            if (!jrParams.isUndefined()) {
+                QJsonValue value(QJsonValue::Undefined);
+                if (jrParams.isArray()) {
+                    auto array = jrParams.toArray();
+                    if (array.size() != 1)
+                        return error(JrError::InvalidParams);
+                    value = array.at(0);
+                } else if (jrParams.isObject()) {
+                    auto object = jrParams.toObject();
+                    if (object.size() != 1)
+                        return error(JrError::InvalidParams);
+                    value = object.begin().value();
+                }
+                if (value.isUndefined())
+                    return error(JrError::InvalidParams);
+                auto var = _JsonToQVariant(value, p.userType());
+                if (!var.isValid())
+                    return error(JrError::InvalidParams);
+                if (!p.write(object, var))
+                    return error(JrError::MethodNotFound);
+            }
+            const auto res = _JsonFromQVariant(p.read(object));
+            if (!res.isUndefined())
+                return { request, res };
+            return error(JrError::InternalError);
+        } case JrRoute::Methods:
+            for (auto &overload : route.overloads) {
+                QJsonValue res(QJsonValue::Undefined);
+                if (jrParams.isArray())
+                    res = invoke(object, overload, jrParams.toArray());
+                else if (jrParams.isObject())
+                    res = invoke(object, overload, jrParams.toObject());
+                else if (jrParams.isUndefined())
+                    res = invoke(object, overload, QJsonArray());
+                if (!res.isUndefined())
+                    return { request, res };
+            }
+            break;
+        }
+        return error(JrError::InvalidParams);
+    }
+
     auto invoke(QObject *object, const QMetaMethod &method, const QList<QVariant> &params) -> QJsonValue
     {
         if (method.parameterCount() > 10)
@@ -37,138 +250,169 @@ struct JrPlayer::Data {
         return _JsonFromQVariant(ret);
     }
 
-    auto invoke(QObject *object, const QMetaMethod &method, const QJsonArray &array) -> QJsonValue
+    auto invoke(QObject *object, const JrOverload &overload, const QJsonArray &array) -> QJsonValue
     {
-        if (method.parameterCount() != array.size())
+        if (overload.types.size() != array.size())
             return QJsonValue::Undefined;
         QList<QVariant> params;
         params.reserve(array.size());
-        for (int i = 0; i < method.parameterCount(); ++i) {
-            auto param = _JsonToQVariant(array.at(i), method.parameterType(i));
+        for (int i = 0; i < overload.types.size(); ++i) {
+            auto param = _JsonToQVariant(array.at(i), overload.types[i]);
             if (!param.isValid())
                 return QJsonValue::Undefined;
             params.push_back(param);
         }
-        return invoke(object, method, params);
+        return invoke(object, overload.method, params);
     }
 
-    auto invoke(QObject *object, const QMetaMethod &method, const QJsonObject &json) -> QJsonValue
+    auto invoke(QObject *object, const JrOverload &overload, const QJsonObject &json) -> QJsonValue
     {
-        if (method.parameterCount() != json.size())
+        if (overload.types.size() != json.size())
             return QJsonValue::Undefined;
         QList<QVariant> params;
         params.reserve(json.size());
-        const auto names = method.parameterNames();
-        Q_ASSERT(names.size() == method.parameterCount());
-        for (int i = 0; i < method.parameterCount(); ++i) {
-            auto param = _JsonToQVariant(json[_L(names[i])], method.parameterType(i));
+        Q_ASSERT(overload.names.size() == overload.types.size());
+        for (int i = 0; i < overload.types.size(); ++i) {
+            auto param = _JsonToQVariant(json[overload.names[i]], overload.types[i]);
             if (!param.isValid())
                 return QJsonValue::Undefined;
-            params.push_back(params);
+            params.push_back(param);
         }
-        return invoke(object, method, params);
+        return invoke(object, overload.method, params);
     }
 };
 
 JrPlayer::JrPlayer(QObject *parent)
     : JrIface(parent), d(new Data)
 {
+    d->p = this;
+    d->invalidate = staticMetaObject.method(staticMetaObject.indexOfSlot("invalidate()"));
 }
 
 JrPlayer::~JrPlayer()
 {
+    d->clear();
     delete d;
 }
 
+auto JrPlayer::invalidate() -> void
+{
+    d->clear();
+}
+
 auto JrPlayer::request(const JrRequest &request) -> JrResponse
 {
     Q_ASSERT(request.isValid());
-    QObject *object = &d->app;
-    int pos = 0;
     const auto jrMethod = request.method();
-    const auto jrParams = request.params();
-    if (jrMethod.startsWith("App."_a))
-        pos = 4;
-    auto error = [&] (JrError e) { return _JrErrorResponse(request.id(), e); };
-    while (pos < jrMethod.size()) {
-        const int next = jrMethod.indexOf('.'_q, pos);
-        if (next > pos) {
-            const auto name = jrMethod.midRef(pos, next - pos).toUtf8();
-            pos = next + 1;
-            const int left = name.indexOf('[');
-            if (left > 0) {
-                QQmlListReference list(object, name.left(left));
-                const int right = name.indexOf(']', left);
-                if (!list.isValid() || right < 0)
-                    break;
-                bool ok = false;
-                const int idx = name.mid(left + 1, right - (left + 1)).toInt(&ok);
-                const auto obj = list.at(idx);
-                if (!ok || !obj)
-                    break;
-                object = obj;
-                continue;
-            }
-            const auto p = object->property(name);
-            if (auto obj = p.value<QObject*>()) {
-                object = obj;
-                continue;
-            }
-            QQmlListReference list(object, name);
-            if (!list.isValid() || jrMethod.midRef(pos) != "length"_a)
-                break;
-            return { request, list.count() };
-        }
-        const auto name = jrMethod.midRef(pos).toUtf8();
-        pos = jrMethod.size();
-        if (name.isEmpty())
-            break;
+    auto it = d->routes.constFind(jrMethod);
+    if (it != d->routes.cend() && it->object) {
+        // call may invalidate the cache and free the node
+        const JrRoute route = *it;
+        return d->call(route, request);
+    }
+    JrRoute route;
+    bool cacheable = true;
+    if (!d->resolve(jrMethod, route, cacheable))
+        return _JrErrorResponse(request.id(), JrError::MethodNotFound);
+    // call may change the tree and invalidate the cache
+    if (cacheable)
+        d->cache(jrMethod, route);
+    return d->call(route, request);
+}
 
-        const auto mo = object->metaObject();
-        const int idx = mo->indexOfProperty(name);
-        if (idx >= 0) {
-            const auto p = mo->property(idx);
-            if (!jrParams.isUndefined()) {
-                QJsonValue value(QJsonValue::Undefined);
-                if (jrParams.isArray()) {
-                    auto array = jrParams.toArray();
-                    if (array.size() != 1)
-                        return error(JrError::InvalidParams);
-                    value = array.at(0);
-                } else if (jrParams.isObject()) {
-                    auto object = jrParams.toObject();
-                    if (object.size() != 1)
-                        return error(JrError::InvalidParams);
-                    value = object.begin().value();
-                }
-                if (value.isUndefined())
-                    return error(JrError::InvalidParams);
-                auto var = _JsonToQVariant(value, p.userType());
-                if (!var.isValid())
-                    return error(JrError::InvalidParams);
-                if (!p.write(object, var))
-                    return error(JrError::MethodNotFound);
+auto JrPlayer::watch(const QString &method, QObject *receiver, const QMetaMethod &changed,
+                     const QMetaMethod &moved) -> QVector<QMetaObject::Connection>
+{
+    QVector<QMetaObject::Connection> connections;
+    JrRoute route;
+    bool cacheable = true;
+    if (!d->resolve(method, route, cacheable) || !cacheable
+            || route.kind != JrRoute::Property)
+        return connections;
+    const auto &p = route.property;
+    if (!p.isConstant() && !p.hasNotifySignal())
+        return connections;
+    for (auto &w : route.watches)
+        connections.push_back(connect(w.first, d->signal(w), receiver, moved));
+    if (p.hasNotifySignal())
+        connections.push_back(connect(route.object, p.notifySignal(), receiver, changed));
+    return connections;
+}
+
+auto JrPlayer::benchmark() -> void
+{
+    const QList<QByteArray> requests = {
+        R"({"jsonrpc":"2.0","id":1,"method":"App.cpu.cores"})",
+        R"({"jsonrpc":"2.0","id":1,"method":"App.memory.usage"})",
+        R"({"jsonrpc":"2.0","id":1,"method":"App.displayName"})",
+        R"({"jsonrpc":"2.0","id":1,"method":"App.textWidth","params":["bomi",12]})"
+    };
+    static constexpr int loop = 10000;
+    JrPlayer player;
+    JrServer server(JrConnection::Local, JrProtocol::Raw);
+    server.setInterface(&player);
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    JrClient client(&buffer, u"benchmark"_q, &server);
+    for (auto &request : requests) {
+        for (bool cached : { false, true }) {
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < loop; ++i) {
+                if (!cached)
+                    player.d->clear();
+                buffer.seek(0);
+                client.parse(request);
             }
-            const auto res = _JsonFromQVariant(p.read(object));
-            if (!res.isUndefined())
-                return { request, res };
-            return _JrErrorResponse(request.id(), JrError::InternalError);
+            const auto ns = timer.nsecsElapsed();
+            _Info("%% %%: %% calls/s", request, cached ? "cached" : "uncached",
+                  qRound64(loop * 1e9 / qMax<qint64>(ns, 1)));
         }
+    }
 
-        for (int i = 0; i < mo->methodCount(); ++i) {
-            if (mo->method(i).name() != name)
-                continue;
-            QJsonValue res(QJsonValue::Undefined);
-            if (jrParams.isArray())
-                res = d->invoke(object, mo->method(i), jrParams.toArray());
-            else if (jrParams.isObject())
-                res = d->invoke(object, mo->method(i), jrParams.toObject());
-            else if (jrParams.isUndefined())
-                res = d->invoke(object, mo->method(i), QJsonArray());
-            if (!res.isUndefined())
-                return { request, res };
+    // load test of persistent HTTP connection with pipelined requests
+    static constexpr int total = 20000, depth = 16;
+    JrServer http(JrConnection::Tcp, JrProtocol::Http);
+    http.setInterface(&player);
+    if (!http.listen(u"localhost"_q, 0))
+        return;
+    const auto name = http.serverName();
+    const int port = name.midRef(name.lastIndexOf(':'_q) + 1).toInt();
+    const auto &body = requests.front();
+    const QByteArray message = "POST / HTTP/1.1\r\nHost: localhost\r\n"
+            "Content-Type: application/json\r\nAccept: application/json\r\n"
+            "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" + body;
+    QTcpSocket socket;
+    QEventLoop eventLoop;
+    QByteArray incoming;
+    int sent = 0, received = 0;
+    auto send = [&] (int count) {
+        for (; count > 0 && sent < total; --count, ++sent)
+            socket.write(message);
+    };
+    QObject::connect(&socket, &QTcpSocket::connected, [&] () { send(depth); });
+    QObject::connect(&socket, &QTcpSocket::readyRead, [&] () {
+        incoming += socket.readAll();
+        // every reply ends with a compact JSON object and a newline
+        int pos = 0, end = 0, done = 0;
+        while ((pos = incoming.indexOf("}\n", pos)) >= 0) {
+            end = pos += 2;
+            ++done;
         }
-        return _JrErrorResponse(request.id(), JrError::InvalidParams);
-    }
-    return _JrErrorResponse(request.id(), JrError::MethodNotFound);
+        incoming.remove(0, end);
+        received += done;
+        send(done);
+        if (received >= total)
+            eventLoop.quit();
+    });
+    QObject::connect(&socket, &QTcpSocket::disconnected, &eventLoop, &QEventLoop::quit);
+    QTimer::singleShot(60000, &eventLoop, &QEventLoop::quit);
+    QElapsedTimer timer;
+    timer.start();
+    socket.connectToHost(QHostAddress::LocalHost, port);
+    eventLoop.exec();
+    const auto ns = timer.nsecsElapsed();
+    _Info("HTTP keep-alive with %% in flight: %% of %% replied, %% requests/s",
+          depth, received, total, qRound64(received * 1e9 / qMax<qint64>(ns, 1)));
+    http.dumpLatency();
 }
@@ -3,12 +3,21 @@
 
 #include "json/jriface.hpp"
 
+// resolved routes of methods are cached until the object tree changes
 class JrPlayer : public JrIface {
+    Q_OBJECT
 public:
     JrPlayer(QObject *parent = nullptr);
     ~JrPlayer();
+    // calls per second through JrServer with and without route cache
+    // and over persistent HTTP connection with pipelined requests
+    static auto benchmark() -> void;
+private slots:
+    void invalidate();
 private:
     auto request(const JrRequest &request) -> JrResponse final;
+    auto watch(const QString &method, QObject *receiver, const QMetaMethod &changed,
+               const QMetaMethod &moved) -> QVector<QMetaObject::Connection> final;
     struct Data;
     Data *d;
 };
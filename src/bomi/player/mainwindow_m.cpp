@@ -168,11 +168,9 @@ auto MainWindow::Data::plugMenu() -> void
         const auto file = _GetOpenFile(nullptr, tr("Open File"), MediaExt | PlaylistExt);
         if (!file.isEmpty()) {
             const Mrl mrl(file);
-            if (_IsSuffixOf(PlaylistExt, mrl.suffix())) {
-                Playlist list;
-                if (list.load(file))
-                    playlist.setList(list);
-            } else
+            if (_IsSuffixOf(PlaylistExt, mrl.suffix()))
+                playlist.load(mrl, EncodingInfo(), true);
+            else
                 openMrl(mrl);
         }
     });
@@ -736,14 +734,8 @@ auto MainWindow::Data::plugMenu() -> void
                 list.save(file);
         }
     });
-    connect(pl[u"regenerate"_q], &QAction::triggered, p, [=] () {
-        const auto mrl = e.mrl();
-        const auto pl = generatePlaylist(mrl);
-        if (!pl.isEmpty()) {
-            playlist.setList(pl);
-            playlist.setLoaded(mrl);
-        }
-    });
+    connect(pl[u"regenerate"_q], &QAction::triggered,
+            p, [=] () { generatePlaylist(e.mrl()); });
     connect(pl[u"clear"_q], &QAction::triggered, p, [=] () { playlist.clear(); });
     connect(pl[u"append-file"_q], &QAction::triggered, p, [this] () {
         const auto files = _GetOpenFiles(nullptr, tr("Open File"), MediaExt | PlaylistExt);
@@ -292,7 +292,8 @@ auto MainWindow::Data::openWith(const OpenMediaInfo &mode,
             break;
         case OpenMediaBehavior::NewPlaylist:
             playlist.clear();
-            pl += generatePlaylist(mrl);
+            if (pl.isEmpty())
+                pl.append(mrl);
             break;
         }
         auto list = playlist.list();
@@ -302,6 +303,8 @@ auto MainWindow::Data::openWith(const OpenMediaInfo &mode,
         }
         playlist.setList(list);
         load(mrl, mode.start_playback, true, sub);
+        if (mode.behavior == OpenMediaBehavior::NewPlaylist)
+            generatePlaylist(mrl);
         if (!mrl.isDvd())
             recent.stack(mrl);
     }
@@ -450,9 +453,12 @@ auto MainWindow::Data::openMrl(const Mrl &mrl) -> void
         if (!e.isRunning())
             load(mrl);
     } else {
-        if (playlist.rowOf(mrl) < 0)
-            playlist.setList(generatePlaylist(mrl));
+        const bool generate = playlist.rowOf(mrl) < 0;
+        if (generate)
+            playlist.setList(Playlist(mrl));
         load(mrl);
+        if (generate)
+            generatePlaylist(mrl);
         if (!mrl.isDvd())
             recent.stack(mrl);
     }
@@ -515,34 +521,25 @@ auto MainWindow::Data::openMimeData(const QMimeData *md) -> void
         e.addSubtitleFiles(subList, pref.sub_enc());
 }
 
-auto MainWindow::Data::generatePlaylist(const Mrl &mrl) const -> Playlist
+SIA generatePlaylist(const Mrl &mrl, const DirListing &dir,
+                     GeneratePlaylist mode, ExtTypes exts) -> Playlist
 {
-    if (mrl.isCueTrack())
-        { Playlist list;  list.load(mrl.cueSheet()); return list; }
-    if (!mrl.isLocalFile() || !pref.enable_generate_playlist())
-        return Playlist(mrl);
-
     Playlist list;
-    const auto mode = pref.generate_playlist();
-    const QFileInfo file(mrl.toLocalFile());
-    const QDir dir = file.dir();
-    const auto filter = _ToNameFilter(pref.exclude_images() ? VideoExt | AudioExt : MediaExt);
+    auto files = dir.filter(exts);
     if (mode == GeneratePlaylist::Folder) {
-        const auto files = dir.entryList(filter, QDir::Files, QDir::Name);
+        // sorted by Playlist::sort() below
         for (int i=0; i<files.size(); ++i)
-            list.push_back(dir.absoluteFilePath(files[i]));
+            list.push_back(dir.filePath(files[i]));
     } else {
-        const auto files = dir.entryInfoList(filter, QDir::Files, QDir::Name);
-        const auto fileName = file.fileName();
+        std::sort(files.begin(), files.end());
+        const auto fileName = QFileInfo(mrl.toLocalFile()).fileName();
+        static QRegEx rxs(uR"((\D*)\d+(.*))"_q);
+        const auto ms = rxs.match(fileName);
         bool prefix = false, suffix = false;
         auto it = files.cbegin();
-        for(; it != files.cend(); ++it) {
-            static QRegEx rxs(uR"((\D*)\d+(.*))"_q);
-            const auto ms = rxs.match(fileName);
-            if (!ms.hasMatch())
-                continue;
+        for(; it != files.cend() && ms.hasMatch(); ++it) {
             static QRegEx rxt(uR"((\D*)\d+(.*))"_q);
-            const auto mt = rxt.match(it->fileName());
+            const auto mt = rxt.match(*it);
             if (!mt.hasMatch())
                 continue;
             if (!prefix && !suffix) {
@@ -559,7 +556,7 @@ auto MainWindow::Data::generatePlaylist(const Mrl &mrl) const -> Playlist
                 if (ms.capturedRef(2) != mt.capturedRef(2))
                     continue;
             }
-            list.append(it->absoluteFilePath());
+            list.append(dir.filePath(*it));
         }
     }
 
@@ -571,6 +568,36 @@ auto MainWindow::Data::generatePlaylist(const Mrl &mrl) const -> Playlist
     }
 }
 
+auto MainWindow::Data::generatePlaylist(const Mrl &mrl) -> void
+{
+    if (playlistScan)
+        playlistScan->cancel();
+    playlistScan = nullptr;
+    const auto before = playlist.list();
+    auto apply = [=] (const Playlist &list) {
+        // user has changed playlist while generating
+        if (list.isEmpty() || playlist.list() != before)
+            return;
+        playlist.setList(list);
+        playlist.setLoaded(e.mrl());
+    };
+    if (mrl.isCueTrack())
+        { Playlist list;  list.load(mrl.cueSheet()); apply(list); return; }
+    if (!mrl.isLocalFile() || !pref.enable_generate_playlist())
+        { apply(Playlist(mrl)); return; }
+
+    const auto mode = pref.generate_playlist();
+    const auto exts = pref.exclude_images() ? VideoExt | AudioExt : MediaExt;
+    const auto path = QFileInfo(mrl.toLocalFile()).absolutePath();
+    playlistScan = DirScanner::instance().scan(path);
+    auto scan = playlistScan.data();
+    connect(scan, &DirScan::listed, p, [=] (const DirListing &dir) {
+        if (playlistScan == scan)
+            apply(::generatePlaylist(mrl, dir, mode, exts));
+    });
+    scan->start();
+}
+
 auto MainWindow::Data::showMessage(const QString &msg, const bool *force) -> void
 {
     if (noMessage)
@@ -740,6 +767,9 @@ auto MainWindow::Data::applyPref() -> void
     e.setResyncAvWhenFilterToggled_locked(p.audio_filter_resync());
 
     e.setSubtitleStyle_locked(p.sub_style());
+    e.setSubtitleGlyphRendering_locked(p.sub_glyph_rendering());
+    e.setSubtitlePrerender_locked(p.sub_cache_mb(), p.sub_prefetch_before_ms(),
+                                  p.sub_prefetch_after_ms());
     e.setAutoselectMode_locked(p.sub_enable_autoselect(), p.sub_autoselect(),
                                p.sub_ext(), p.sub_prefer_external());
     e.unlock();
@@ -25,6 +25,7 @@
 #include "os/os.hpp"
 #include "misc/smbauth.hpp"
 #include "misc/dataevent.hpp"
+#include "misc/dirscanner.hpp"
 #include "json/jrserver.hpp"
 #include "player/jrplayer.hpp"
 #include <QUndoCommand>
@@ -117,6 +118,7 @@ struct MainWindow::Data {
     QSharedPointer<IntrplDialog> intrpl, chroma, intrplDown;
     QSharedPointer<EncoderDialog> encoder;
     PlaylistModel playlist;
+    QPointer<DirScan> playlistScan;
     QUndoStack undo;
     Downloader downloader;
     TrayIcon *tray = nullptr;
@@ -181,7 +183,8 @@ struct MainWindow::Data {
     auto commitData() -> void;
     auto initWindow() -> void;
     auto initTray() -> void;
-    auto generatePlaylist(const Mrl &mrl) const -> Playlist;
+    // replaces playlist asynchronously unless it is changed meanwhile
+    auto generatePlaylist(const Mrl &mrl) -> void;
     auto openMrl(const Mrl &mrl) -> void;
     auto openMimeData(const QMimeData *md) -> void;
     auto plugEngine() -> void;
@@ -1,15 +1,22 @@
 #include "mpv.hpp"
 #include "video/mpvosdrenderer.hpp"
+#include "misc/trace.hpp"
 #include <QOpenGLContext>
 #include <QLibrary>
 
 struct PropertyObservation {
     int event;
     const char *name = nullptr;
-    std::function<void(int)> notify = nullptr;      // post from mpv to qt
-    std::function<void(QEvent*)> process = nullptr; // handle posted event
+    mpv_format format = MPV_FORMAT_NONE;
+    // store value in mpv thread
+    std::function<void(const mpv_event_property*)> notify = nullptr;
+    // handle stored value in qt thread, null if notify does everything
+    std::function<void(void)> deliver = nullptr;
+    bool pending = false;
 };
 
+// one event delivers all changed properties
+static constexpr const int FlushEvent = QEvent::User + 9999;
 static constexpr const int UpdateEventBegin = QEvent::User + 10000;
 
 auto Mpv::e2l(int error) -> Log::Level
@@ -31,22 +38,65 @@ struct Mpv::Data {
     Mpv *p = nullptr;
     mpv_opengl_cb_context *gl = nullptr;
     MpvOsdRenderer osd;
-    bool quit = false;
+    // set from other threads to stop the loop without shutting down mpv
+    QAtomicInt quit = 0;
+    // every return of mpv_wait_event(), with or without an event
+    QAtomicInt wakeups = 0, eventCount = 0;
     QVector<PropertyObservation> observations;
     QVector<std::function<void(mpv_event*)>> events;
     QMap<QByteArray, std::function<void(void)>> hooks;
     int updateEventMax = ::UpdateEventBegin;
     int hookId = 0;
     std::function<void(void)> update;
-    auto observation(int event) -> const PropertyObservation&
+    QMutex mutex; // for pending, changed and posted
+    QVector<int> changed;
+    bool posted = false;
+    auto observation(int event) -> PropertyObservation&
     {
         Q_ASSERT(UpdateEventBegin <= event && event < updateEventMax);
         Q_ASSERT(event == observations[event - UpdateEventBegin].event);
         return observations[event - UpdateEventBegin];
     }
+    auto notify(const mpv_event *ev) -> void
+    {
+        auto &o = observation(ev->reply_userdata);
+        TraceScope trace(o.name);
+        o.notify(static_cast<const mpv_event_property*>(ev->data));
+        if (!o.deliver)
+            return;
+        QMutexLocker locker(&mutex);
+        if (!o.pending) {
+            o.pending = true;
+            changed.push_back(o.event);
+        }
+        if (!posted) {
+            posted = true;
+            _PostEvent(p->m_observer, FlushEvent);
+        }
+    }
+    auto flush() -> void
+    {
+        QVector<int> events;
+        {
+            QMutexLocker locker(&mutex);
+            events.swap(changed);
+            for (int event : events)
+                observation(event).pending = false;
+            posted = false;
+        }
+        for (int event : events)
+            observation(event).deliver();
+    }
     auto reset()
     {
-        quit = false;
+        quit.store(0);
+        wakeups.store(0);
+        eventCount.store(0);
+        {
+            QMutexLocker locker(&mutex);
+            changed.clear();
+            posted = false;
+        }
         observations.clear();
         events.clear();
         hooks.clear();
@@ -103,6 +153,11 @@ auto Mpv::initialize(Log::Level lv, bool ogl) -> void
 auto Mpv::destroy() -> void
 {
     if (m_handle) {
+        // loop should not be blocked in the handle being destroyed
+        if (isRunning()) {
+            interrupt();
+            wait();
+        }
         mpv_terminate_destroy(m_handle);
         m_handle = nullptr;
         d->gl = nullptr;
@@ -184,18 +239,21 @@ auto Mpv::request(mpv_event_id id, std::function<void(mpv_event*)> &&proc) -> vo
     d->events[id] = std::move(proc);
 }
 
-auto Mpv::newObservation(const char *name, std::function<void(int)> &&notify,
-                  std::function<void(QEvent*)> &&process) -> int
+auto Mpv::newObservation(const char *name, mpv_format format,
+                         std::function<void(const mpv_event_property*)> &&notify,
+                         std::function<void(void)> &&deliver) -> int
 {
     const int event = d->updateEventMax++;
     PropertyObservation ob;
     ob.event = event;
     ob.name = name;
+    ob.format = format;
     ob.notify = std::move(notify);
-    ob.process = std::move(process);
+    ob.deliver = std::move(deliver);
     d->observations.append(ob);
     Q_ASSERT(d->observations.size() == d->updateEventMax - UpdateEventBegin);
-    mpv_observe_property(m_handle, ob.event, ob.name, MPV_FORMAT_NONE);
+    // value comes with event unless format is none
+    mpv_observe_property(m_handle, ob.event, ob.name, ob.format);
     return event;
 }
 
@@ -214,17 +272,19 @@ auto Mpv::get_osd(const char *name) const -> QString
 auto Mpv::run() -> void
 {
     _Debug("Start playloop thread");
-    d->quit = false;
-    while (!d->quit) {
-        auto ev = mpv_wait_event(m_handle, 0.005);
+    // block until an event arrives or interrupt() is called
+    while (!d->quit.load()) {
+        auto ev = mpv_wait_event(m_handle, -1);
+        d->wakeups.ref();
+        if (ev->event_id != MPV_EVENT_NONE)
+            d->eventCount.ref();
         switch (ev->event_id) {
         case MPV_EVENT_NONE:
             break;
-        case MPV_EVENT_PROPERTY_CHANGE: {
-            auto &o = d->observation(ev->reply_userdata);
-            o.notify(o.event);
+        case MPV_EVENT_PROPERTY_CHANGE:
+            d->notify(ev);
             break;
-        } case MPV_EVENT_LOG_MESSAGE: {
+        case MPV_EVENT_LOG_MESSAGE: {
             auto msg = static_cast<mpv_event_log_message*>(ev->data);
             if (msg->log_level == MPV_LOG_LEVEL_NONE)
                 break;
@@ -239,7 +299,7 @@ auto Mpv::run() -> void
                 }
             };
             const auto lv = getLevel();
-            Log::print(lv, Log::parse(lv, m_logContext + '/' + msg->prefix, msg->text));
+            Log::print(lv, m_logContext + '/' + msg->prefix, msg->text);
             break;
         } case MPV_EVENT_CLIENT_MESSAGE: {
             auto message = static_cast<mpv_event_client_message*>(ev->data);
@@ -271,7 +331,7 @@ auto Mpv::run() -> void
             _Error("Never requested reply: %%", event->name);
             break;
         } case MPV_EVENT_SHUTDOWN:
-            d->quit = true;
+            d->quit.store(1);
             break;
         default: {
             if (ev->event_id >= d->events.size())
@@ -283,12 +343,47 @@ auto Mpv::run() -> void
     _Debug("Finish playloop thread");
 }
 
+auto Mpv::interrupt() -> void
+{
+    d->quit.store(1);
+    if (m_handle)
+        mpv_wakeup(m_handle);
+}
+
+auto Mpv::stats() const -> MpvStats
+{
+    MpvStats stats;
+    stats.wakeups = d->wakeups.load();
+    stats.events = d->eventCount.load();
+    return stats;
+}
+
+auto Mpv::benchmark() -> void
+{
+    // nothing happens in idle mode, so every wakeup is a waste of power
+    static constexpr int duration = 2000;
+    Mpv mpv;
+    mpv.setLogContext("mpv/idle");
+    mpv.create();
+    mpv.setOption("vo", "null");
+    mpv.setOption("ao", "null");
+    mpv.setOption("idle", "yes");
+    mpv.initialize(Log::Error, false);
+    mpv.start();
+    QThread::msleep(duration);
+    const auto stats = mpv.stats();
+    mpv.destroy();
+    // static member cannot use log context of instance
+    Log::write(Log::Info, [&] () {
+        return Log::parse(Log::Info, "Mpv", "idle for %%ms: %% wakeups, %% events",
+                          duration, stats.wakeups, stats.events);
+    });
+}
+
 auto Mpv::process(QEvent *event) -> bool
 {
-    const int type = event->type();
-    if (UpdateEventBegin <= type && type < d->updateEventMax) {
-        d->observation(type).process(event);
-        return true;
-    }
-    return false;
+    if (event->type() != FlushEvent)
+        return false;
+    d->flush();
+    return true;
 }
@@ -17,6 +17,9 @@ SCIA s2ms(double s) -> int { return s*1000 + 0.5; }
 #define MPV_CHECK(err, fmt, ...) \
     (isSuccess(err) ? true : (_WriteLog(e2l(err), "Failed to " fmt ": %%", __VA_ARGS__, e2s(err)), false))
 
+// counted in the event loop since the last destroy()
+struct MpvStats { int wakeups = 0, events = 0; };
+
 class Mpv : public QThread {
     template<class R, class...Args> using func = std::function<R(Args...)>;
     template<class T> using trait = mpv_trait<T>;
@@ -40,6 +43,11 @@ public:
     auto initialize(Log::Level lv, bool ogl = true) -> void;
     auto destroy() -> void;
     auto process(QEvent *event) -> bool;
+    // stops the event loop from any thread without waiting
+    auto interrupt() -> void;
+    auto stats() const -> MpvStats;
+    // counts wakeups of idle instance with null outputs
+    static auto benchmark() -> void;
 
     template<class... Args>
     auto fatal(int err, const char *msg, const Args &... args) const -> void;
@@ -123,8 +131,19 @@ private:
         int error = f(&node);
         return MPV_CHECK(error, "execute %%", name);
     }
-    auto newObservation(const char *name, std::function<void(int)> &&notify,
-                        std::function<void(QEvent*)> &&process) -> int;
+    template<class T>
+    static auto decode(const mpv_event_property *property) -> T
+    {
+        T t = T();
+        if (property->format == trait<T>::format && property->data)
+            trait<T>::get(t, *static_cast<const type<T>*>(property->data));
+        return t;
+    }
+    template<class T, class Get, class Set>
+    auto coalesce(const char *name, mpv_format format, Get get, Set set) -> int;
+    auto newObservation(const char *name, mpv_format format,
+                        std::function<void(const mpv_event_property*)> &&notify,
+                        std::function<void(void)> &&deliver) -> int;
     struct Data; Data *d;
     mpv_handle *m_handle = nullptr;
     QObject *m_observer = nullptr;
@@ -198,39 +217,61 @@ template<int N, class... Args>
 auto Mpv::tellAsync(const char (&name)[N], const Args&... args) -> bool
     { return tellAsync(QByteArray::fromRawData(name, N), args...); }
 
+// keeps only the latest value until the observer handles it
+template<class T, class Get, class Set>
+auto Mpv::coalesce(const char *name, mpv_format format, Get get, Set set) -> int
+{
+    struct Latest { QMutex mutex; T value = T(); };
+    auto latest = std::make_shared<Latest>();
+    return newObservation(name, format, [=] (const mpv_event_property *property) {
+        auto value = get(property);
+        QMutexLocker locker(&latest->mutex);
+        latest->value = std::move(value);
+    }, [=] () {
+        T value;
+        {
+            QMutexLocker locker(&latest->mutex);
+            value = std::move(latest->value);
+        }
+        set(std::move(value));
+    });
+}
+
 template<class Get, class Set>
 auto Mpv::observe(const char *name, Get get, Set set) -> tmp::enable_if_callable_t<Get, int>
 {
     using T = tmp::remove_cref_t<decltype(get())>;
-    return newObservation(name, [=] (int e) { _PostEvent(m_observer, e, get()); },
-                          [=] (QEvent *event) { set(_MoveData<T>(event)); });
+    return coalesce<T>(name, MPV_FORMAT_NONE,
+                       [=] (const mpv_event_property*) { return get(); }, set);
 }
 
 template<class T, class Update>
 auto Mpv::observe(const char *name, T &t, Update update) -> tmp::enable_unless_callable_t<T, int>
 {
-    return observe(name, [=] () { return get<T>(name); },
-                   [=, &t] (T &&v) { if (_Change(t, v)) update(); });
+    return coalesce<T>(name, trait<T>::format, &Mpv::decode<T>,
+                       [=, &t] (T &&v) { if (_Change(t, v)) update(); });
 }
 
 template<class Update>
 auto Mpv::observeTime(const char *name, int &t, Update update) -> int
 {
-    return observe(name, [=] () { return s2ms(get<double>(name)); },
-                   [=, &t] (int &&v) { if (_Change(t, v)) update(); });
+    return coalesce<int>(name, MPV_FORMAT_DOUBLE, [] (const mpv_event_property *property)
+                         { return s2ms(decode<double>(property)); },
+                         [=, &t] (int &&v) { if (_Change(t, v)) update(); });
 }
 
 template<class Set>
 auto Mpv::observe(const char *name, Set set) -> int {
     using T = tmp::remove_ref_t<tmp::func_arg_t<Set, 0>>;
-    return observe(name, [=] () { return get<T>(name); }, set);
+    return coalesce<T>(name, trait<T>::format, &Mpv::decode<T>, set);
 }
 
 template<class Check>
 auto Mpv::observeState(const char *name, Check ck) -> int
 {
     using T = tmp::remove_ref_t<tmp::func_arg_t<Check, 0>>;
-    return newObservation(name, [=] (int) { ck(get<T>(name)); }, [](QEvent*){});
+    return newObservation(name, trait<T>::format, [=] (const mpv_event_property *property)
+                          { ck(decode<T>(property)); }, nullptr);
 }
 
 #endif // MPV_HPP
@@ -2,37 +2,145 @@
 #include "tmp/algorithm.hpp"
 #include "misc/udf25.hpp"
 #include <QCryptographicHash>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
 
-Mrl::Mrl(const QUrl &url) {
+// interned directories are dropped at once when too many are collected,
+// Mrls created before keep their copies
+static constexpr int MaxInterned = 64 * 1024;
+
+static auto intern(const QString &dir) -> QString
+{
+    static QMutex mutex;
+    static QSet<QString> interned;
+    QMutexLocker locker(&mutex);
+    const auto it = interned.constFind(dir);
+    if (it != interned.cend())
+        return *it;
+    if (interned.size() >= MaxInterned)
+        interned.clear();
+    interned.insert(dir);
+    return dir;
+}
+
+Mrl::Mrl()
+{
+    static const QSharedDataPointer<Data> null(new Data);
+    d = null;
+}
+
+Mrl::Mrl(const QUrl &url)
+    : Mrl()
+{
     if (url.isLocalFile())
-        m_loc = "file://"_a % url.toLocalFile();
+        set("file://"_a % url.toLocalFile(), QString());
     else
-        m_loc = url.toString();
+        set(url.toString(), QString());
 }
 
-Mrl::Mrl(const QString &location, const QString &name) {
+Mrl::Mrl(const QString &location, const QString &name)
+    : Mrl()
+{
     if (location.isEmpty())
         return;
-    m_loc = location;
+    QString loc;
     const int idx = location.indexOf("://"_a);
     if (idx < 0)
-        m_loc = "file://"_a % _ToAbsFilePath(location);
-    else if (startsWith("file://"_a))
-        m_loc = QUrl::fromPercentEncoding(location.toUtf8());
-    else if (startsWith("dvdnav://"_a) || startsWith("bdnav://"_a) || startsWith("cue://"_a))
-        m_loc = location;
+        loc = "file://"_a % _ToAbsFilePath(location);
+    else if (location.startsWith("file://"_a, Qt::CaseInsensitive))
+        loc = QUrl::fromPercentEncoding(location.toUtf8());
+    else if (location.startsWith("dvdnav://"_a, Qt::CaseInsensitive)
+             || location.startsWith("bdnav://"_a, Qt::CaseInsensitive)
+             || location.startsWith("cue://"_a, Qt::CaseInsensitive))
+        loc = location;
     else
-        m_loc = QUrl::fromPercentEncoding(location.toUtf8());
-    m_name = name;
+        loc = QUrl::fromPercentEncoding(location.toUtf8());
+    set(loc, name);
+}
+
+auto Mrl::set(const QString &location, const QString &name) -> void
+{
+    const int slash = location.lastIndexOf('/'_q);
+    d->dir = slash < 0 ? QString() : intern(location.left(slash + 1));
+    d->leaf = location.mid(slash + 1);
+    d->name = name;
+    d->flags = 0;
+    if (startsWith("file://"_a))
+        d->flags |= Local;
+    else if (startsWith("dvdnav://"_a))
+        d->flags |= Dvd;
+    else if (startsWith("bdnav://"_a))
+        d->flags |= Bluray;
+    else if (d->dir.startsWith("cue://"_a))
+        d->flags |= Cue;
+
+    // cached because views ask it for every row
+    d->display = [&] () -> QString {
+        if (!d->name.isEmpty())
+            return d->name;
+        if (isLocalFile())
+            return d->leaf;
+        QString disc;
+        if (isDvd())
+            disc = QCoreApplication::translate("Mrl", "DVD");
+        else if (isBluray())
+            disc = QCoreApplication::translate("Mrl", "Blu-ray");
+        if (disc.isEmpty()) {
+            const auto suffix = this->suffix();
+            if (_IsSuffixOf(MediaExt, suffix))
+                return path();
+            return toString();
+        }
+        auto dev = device();
+        if (dev.isEmpty())
+            return disc;
+        if (!dev.startsWith("/dev/"_a)) {
+            QRegEx regex(u"/([^/]+)/*$"_q);
+            auto match = regex.match(dev);
+            if (match.hasMatch())
+                dev = match.captured(1);
+        }
+        return disc % " ("_a % dev % ')'_q;
+    }();
+}
+
+auto Mrl::operator < (const Mrl &rhs) const -> bool
+{
+    if (d->dir == rhs.d->dir)
+        return d->leaf < rhs.d->leaf;
+    return toString() < rhs.toString();
+}
+
+auto Mrl::startsWith(const QString &s) const -> bool
+{
+    if (s.size() <= d->dir.size())
+        return d->dir.startsWith(s, Qt::CaseInsensitive);
+    return toString().startsWith(s, Qt::CaseInsensitive);
+}
+
+auto Mrl::startsWith(const QLatin1String &s) const -> bool
+{
+    if (s.size() <= d->dir.size())
+        return d->dir.startsWith(s, Qt::CaseInsensitive);
+    return toString().startsWith(s, Qt::CaseInsensitive);
+}
+
+auto Mrl::scheme() const -> QString
+{
+    const int idx = d->dir.indexOf("://"_a);
+    return idx < 0 ? toString() : d->dir.left(idx);
 }
 
 auto Mrl::path() const -> QString
 {
-    return isLocalFile() ? m_loc : QUrl(m_loc).path();
+    return isLocalFile() ? toString() : QUrl(toString()).path();
 }
 
 auto Mrl::fileName() const -> QString
 {
+    if (isLocalFile())
+        return d->leaf;
     const auto path = this->path();
     return path.mid(path.lastIndexOf('/'_q) + 1);
 }
@@ -44,35 +152,6 @@ auto Mrl::suffix() const -> QString
     return idx != -1 ? path.mid(idx + 1) : QString();
 }
 
-auto Mrl::displayName() const -> QString
-{
-    if (!m_name.isEmpty())
-        return m_name;
-    if (isLocalFile())
-        return fileName();
-    QString disc;
-    if (isDvd())
-        disc = qApp->translate("Mrl", "DVD");
-    else if (isBluray())
-        disc = qApp->translate("Mrl", "Blu-ray");
-    if (disc.isEmpty()) {
-        const auto suffix = this->suffix();
-        if (_IsSuffixOf(MediaExt, suffix))
-            return path();
-        return m_loc;
-    }
-    auto dev = device();
-    if (dev.isEmpty())
-        return disc;
-    if (!dev.startsWith("/dev/"_a)) {
-        QRegEx regex(u"/([^/]+)/*$"_q);
-        auto match = regex.match(dev);
-        if (match.hasMatch())
-            dev = match.captured(1);
-    }
-    return disc % " ("_a % dev % ')'_q;
-}
-
 auto Mrl::isImage() const -> bool
 {
     return _IsSuffixOf(ImageExt, suffix());
@@ -80,24 +159,16 @@ auto Mrl::isImage() const -> bool
 
 auto Mrl::isEmpty() const -> bool
 {
-    const int idx = m_loc.indexOf("://"_a);
-    return (idx < 0) || !(idx+3 < m_loc.size());
-}
-
-static const QStringList discSchemes = QStringList()
-        << u"dvdnav"_q << u"bdnav"_q;
-
-auto Mrl::isDisc() const -> bool
-{
-    return discSchemes.contains(scheme(), Qt::CaseInsensitive);
+    const int idx = d->dir.indexOf("://"_a);
+    return (idx < 0) || !(idx+3 < d->dir.size() + d->leaf.size());
 }
 
 auto Mrl::device() const -> QString
 {
-    const auto scheme = this->scheme();
-    if (!discSchemes.contains(scheme, Qt::CaseInsensitive))
+    if (!isDisc())
         return QString();
-    auto path = m_loc.midRef(scheme.size() + 3);
+    const auto loc = toString();
+    auto path = loc.midRef(scheme().size() + 3);
     const int idx = path.indexOf('/'_q);
     if (idx < 0)
         return QString();
@@ -125,26 +196,22 @@ auto Mrl::fromCueTrack(const QString &cue, const CueTrack &track,
     return Mrl(list.join(u":;"_q), name);
 }
 
-auto Mrl::isCueTrack() const -> bool
-{
-    return m_loc.startsWith("cue://"_a);
-}
-
 auto Mrl::cueSheet() const -> QString
 {
     if (!isCueTrack())
         return QString();
-    const int end = m_loc.indexOf(u":;"_q, 6);
+    const auto loc = toString();
+    const int end = loc.indexOf(u":;"_q, 6);
     if (end < 6)
         return QString();
-    return m_loc.mid(6, end - 6);
+    return loc.mid(6, end - 6);
 }
 
 auto Mrl::toCueTrack() const -> CueTrack
 {
     if (!isCueTrack())
         return CueTrack();
-    const auto strs = m_loc.mid(6).split(u":;"_q);
+    const auto strs = toString().mid(6).split(u":;"_q);
     if (strs.size() != 4)
         return CueTrack();
     CueTrack track;
@@ -157,10 +224,83 @@ auto Mrl::toCueTrack() const -> CueTrack
 auto Mrl::titleMrl(int title) const -> Mrl
 {
     auto mrl = fromDisc(scheme(), device(), title, false);
-    mrl.m_hash = m_hash;
+    mrl.d->hash = d->hash;
     return mrl;
 }
 
+namespace {
+
+struct DiscBlock { qint64 offset = -1; int size = 0; QByteArray data; };
+
+// size and modified time of image file, or index file for directory
+struct DiscStamp {
+    DECL_EQ(DiscStamp, &T::size, &T::modified)
+    qint64 size = -1;
+    QDateTime modified;
+    auto isValid() const -> bool { return size >= 0; }
+};
+
+}
+
+static constexpr int DiscBlockSize = 2048;
+
+static auto discBlock(::udf::File &file) -> DiscBlock
+{
+    DiscBlock block;
+    block.size = qMin<quint64>(DiscBlockSize, file.size());
+    qint64 contiguous = 0;
+    block.offset = file.offset(0, &contiguous);
+    // rare file fragmented in the first block
+    if (block.offset < 0 || contiguous < block.size) {
+        block.offset = -1;
+        block.data = file.read(block.size);
+    }
+    return block;
+}
+
+// reads blocks sorted by offset and merges adjacent ones into one read
+static auto readBlocks(const QString &image, QVector<DiscBlock> &blocks) -> bool
+{
+    QFile file(image);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+    QVector<int> order;
+    for (int i = 0; i < blocks.size(); ++i) {
+        if (blocks[i].offset >= 0)
+            order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&] (int lhs, int rhs)
+        { return blocks[lhs].offset < blocks[rhs].offset; });
+    for (int i = 0, j = 0; i < order.size(); i = j) {
+        const qint64 begin = blocks[order[i]].offset;
+        qint64 end = begin + blocks[order[i]].size;
+        for (j = i + 1; j < order.size() && blocks[order[j]].offset <= end; ++j)
+            end = qMax(end, blocks[order[j]].offset + blocks[order[j]].size);
+        QByteArray chunk(end - begin, Qt::Uninitialized);
+#ifdef Q_OS_UNIX
+        const qint64 read = ::pread(file.handle(), chunk.data(), chunk.size(), begin);
+#else
+        const qint64 read = file.seek(begin) ? file.read(chunk.data(), chunk.size()) : -1;
+#endif
+        if (read < 0)
+            return false;
+        chunk.resize(read);
+        for (int k = i; k < j; ++k) {
+            auto &block = blocks[order[k]];
+            block.data = chunk.mid(block.offset - begin, block.size);
+        }
+    }
+    return true;
+}
+
+static auto discHash(const QVector<DiscBlock> &blocks) -> QByteArray
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    for (auto &block : blocks)
+        hash.addData(block.data);
+    return hash.result().toHex();
+}
+
 static QByteArray dvdHash(const QString &device) {
     static QStringList files = QStringList()
         << u"/VIDEO_TS/VIDEO_TS.IFO"_q
@@ -173,14 +313,14 @@ static QByteArray dvdHash(const QString &device) {
         << u"/VIDEO_TS/VTS_07_0.IFO"_q
         << u"/VIDEO_TS/VTS_08_0.IFO"_q
         << u"/VIDEO_TS/VTS_09_0.IFO"_q;
-    static constexpr int block = 2048;
-    QByteArray data;
+    QVector<DiscBlock> blocks;
     if (QFileInfo(device).isDir()) {
         for (auto &fileName : files) {
             QFile file(device % fileName);
             if (!file.open(QFile::ReadOnly))
                 break;
-            data += file.read(block);
+            blocks.push_back(DiscBlock());
+            blocks.last().data = file.read(DiscBlockSize);
         }
     } else {
         udf::udf25 udf;
@@ -190,17 +330,18 @@ static QByteArray dvdHash(const QString &device) {
             ::udf::File file(&udf, fileName);
             if (!file.isOpen())
                 break;
-            data += file.read(block);
+            blocks.push_back(discBlock(file));
         }
+        if (!readBlocks(device, blocks))
+            return QByteArray();
     }
-    return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+    return discHash(blocks);
 }
 
 static QByteArray blurayHash(const QString &device) {
-    static constexpr int block = 2048;
     QStringList files = QStringList()
             << u"/BDMV/index.bdmv"_q << u"/BDMV/MovieObject.bdmv"_q;
-    QByteArray data;
+    QVector<DiscBlock> blocks;
     if (QFileInfo(device).isDir()) {
         auto dir = [&] (const QString &path) {
             QDir dir(device % path);
@@ -215,8 +356,10 @@ static QByteArray blurayHash(const QString &device) {
         tmp::sort(files);
         for (auto &fileName : files) {
             QFile file(device % fileName);
-            if (file.open(QFile::ReadOnly))
-                data += file.read(block);
+            if (file.open(QFile::ReadOnly)) {
+                blocks.push_back(DiscBlock());
+                blocks.last().data = file.read(DiscBlockSize);
+            }
         }
     } else {
         udf::udf25 fs;
@@ -236,10 +379,28 @@ static QByteArray blurayHash(const QString &device) {
         for (auto &fileName : files) {
             ::udf::File file(&fs, fileName);
             if (file.isOpen())
-                data += file.read(block);
+                blocks.push_back(discBlock(file));
         }
+        if (!readBlocks(device, blocks))
+            return QByteArray();
+    }
+    return discHash(blocks);
+}
+
+static auto discStamp(const QString &device, bool dvd) -> DiscStamp
+{
+    QFileInfo info(device);
+    if (info.isDir())
+        info.setFile(device % (dvd ? "/VIDEO_TS/VIDEO_TS.IFO"_a : "/BDMV/index.bdmv"_a));
+    // disc in drive can be changed without any change of device file
+    else if (!info.isFile())
+        return DiscStamp();
+    DiscStamp stamp;
+    if (info.exists()) {
+        stamp.size = info.size();
+        stamp.modified = info.lastModified();
     }
-    return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+    return stamp;
 }
 
 auto Mrl::calculateHash(const Mrl &mrl) -> QByteArray
@@ -249,45 +410,60 @@ auto Mrl::calculateHash(const Mrl &mrl) -> QByteArray
     const auto device = mrl.device();
     if (device.isEmpty())
         return QByteArray();
-    return mrl.isDvd() ? dvdHash(device) : blurayHash(device);
+    struct Cached { DiscStamp stamp; QByteArray hash; };
+    static QMutex mutex;
+    static QHash<QString, Cached> cache;
+    const auto key = mrl.scheme() % "://"_a % device;
+    const auto stamp = discStamp(device, mrl.isDvd());
+    if (stamp.isValid()) {
+        QMutexLocker locker(&mutex);
+        const auto it = cache.constFind(key);
+        if (it != cache.cend() && it->stamp == stamp)
+            return it->hash;
+    }
+    const auto hash = mrl.isDvd() ? dvdHash(device) : blurayHash(device);
+    if (stamp.isValid() && !hash.isEmpty()) {
+        QMutexLocker locker(&mutex);
+        cache[key] = { stamp, hash };
+    }
+    return hash;
 }
 
 auto Mrl::updateHash() -> void
 {
-    m_hash = calculateHash(*this);
+    d->hash = calculateHash(*this);
 }
 
 auto Mrl::toUnique() const -> Mrl
 {
     if (!isDisc())
         return *this;
-    if (m_hash.isEmpty())
+    if (d->hash.isEmpty())
         return Mrl();
     Mrl mrl;
-    mrl.m_loc = scheme() % ":///"_a % QString::fromUtf8(m_hash);
-    mrl.m_hash = m_hash;
-    mrl.m_name = m_name;
+    mrl.set(scheme() % ":///"_a % QString::fromUtf8(d->hash), d->name);
+    mrl.d->hash = d->hash;
     return mrl;
 }
 
 auto Mrl::fromUniqueId(const QString &id, const QString &device, const QString &name) -> Mrl
 {
     Mrl mrl;
-    mrl.m_loc = id;
-    mrl.m_name = name;
+    mrl.set(id, name);
     if (!mrl.isDisc())
         return mrl;
-    mrl.m_hash = mrl.device().toUtf8();
-    mrl.m_loc = mrl.scheme() % "://"_a;
+    mrl.d->hash = mrl.device().toUtf8();
+    QString loc = mrl.scheme() % "://"_a;
     if (!device.isEmpty())
-        mrl.m_loc += '/'_q % device;
+        loc += '/'_q % device;
+    mrl.set(loc, name);
     return mrl;
 }
 
 auto Mrl::isYouTube() const -> bool
 {
     QRegEx rx(uR"(^https?://(www\.)?youtube\.com)"_q, QRegEx::CaseInsensitiveOption);
-    return rx.match(m_loc).hasMatch();
+    return rx.match(toString()).hasMatch();
 }
 
 auto Mrl::isDir() const -> bool
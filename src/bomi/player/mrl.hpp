@@ -3,46 +3,48 @@
 
 #include "global.hpp"
 
+// location is split into interned directory and leaf name so that entries
+// in the same directory share the prefix, and copies share everything
 class Mrl {
 public:
     struct CueTrack { QString file; int start = -1, end = -1; };
-    Mrl() {}
+    Mrl();
     Mrl(const QUrl &url);
     Mrl(const QString &location, const QString &name = QString());
-    auto operator == (const Mrl &rhs) const -> bool {return m_loc == rhs.m_loc;}
+    auto operator == (const Mrl &rhs) const -> bool
+        { return d == rhs.d || (d->leaf == rhs.d->leaf && d->dir == rhs.d->dir); }
     auto operator != (const Mrl &rhs) const -> bool {return !(*this == rhs);}
-    auto operator < (const Mrl &rhs) const -> bool {return m_loc < rhs.m_loc;}
+    auto operator < (const Mrl &rhs) const -> bool;
     auto location() const -> QString
-        { auto loc = toLocalFile(); return loc.isEmpty() ? m_loc : loc; }
-    auto toString() const -> QString { return m_loc; }
-    auto startsWith(const QString &s) const -> bool
-        { return m_loc.startsWith(s, Qt::CaseInsensitive); }
-    auto startsWith(const QLatin1String &s) const -> bool
-        { return m_loc.startsWith(s, Qt::CaseInsensitive); }
-    auto isLocalFile() const -> bool { return startsWith("file://"_a); }
-    auto isDvd() const -> bool { return startsWith("dvdnav://"_a); }
-    auto isBluray() const -> bool { return startsWith("bdnav://"_a); }
-    auto isDisc() const -> bool;
-    auto isCueTrack() const -> bool;
+        { auto loc = toLocalFile(); return loc.isEmpty() ? toString() : loc; }
+    auto toString() const -> QString
+        { return d->dir.isEmpty() ? d->leaf : d->dir % d->leaf; }
+    auto startsWith(const QString &s) const -> bool;
+    auto startsWith(const QLatin1String &s) const -> bool;
+    auto isLocalFile() const -> bool { return d->flags & Local; }
+    auto isDvd() const -> bool { return d->flags & Dvd; }
+    auto isBluray() const -> bool { return d->flags & Bluray; }
+    auto isDisc() const -> bool { return d->flags & (Dvd | Bluray); }
+    auto isCueTrack() const -> bool { return d->flags & Cue; }
     auto isRemoteUrl() const -> bool { return !isLocalFile() && !isDisc(); }
-    auto scheme() const -> QString {return m_loc.left(m_loc.indexOf("://"_a));}
+    auto scheme() const -> QString;
     auto toLocalFile() const -> QString
-        {return isLocalFile() ? m_loc.right(m_loc.size() - 7) : QString();}
+        {return isLocalFile() ? d->dir.mid(7) % d->leaf : QString();}
     auto fileName() const -> QString;
 //    auto isPlaylist() const -> bool;
-    auto displayName() const -> QString;
+    auto displayName() const -> QString { return d->display; }
     auto isEmpty() const -> bool;
     auto isYouTube() const -> bool;
     auto suffix() const -> QString;
-    auto name() const -> QString { return m_name; }
+    auto name() const -> QString { return d->name; }
     auto isImage() const -> bool;
     auto titleMrl(int title) const -> Mrl;
     auto device() const -> QString;
-    auto toLocal8Bit() const -> QByteArray { return m_loc.toLocal8Bit(); }
-    auto toUtf8() const -> QByteArray { return m_loc.toUtf8(); }
-    auto hash() const -> QByteArray { return m_hash; }
+    auto toLocal8Bit() const -> QByteArray { return toString().toLocal8Bit(); }
+    auto toUtf8() const -> QByteArray { return toString().toUtf8(); }
+    auto hash() const -> QByteArray { return d->hash; }
     auto updateHash() -> void;
-    auto isUnique() const -> bool { return !isDisc() || !m_hash.isEmpty(); }
+    auto isUnique() const -> bool { return !isDisc() || !d->hash.isEmpty(); }
     auto toUnique() const -> Mrl;
     auto isDir() const -> bool;
     auto start() const -> int;
@@ -50,7 +52,7 @@ public:
     auto toCueTrack() const -> CueTrack;
     auto cueSheet() const -> QString;
     static auto fromString(const QString str) -> Mrl
-        { Mrl mrl; mrl.m_loc = str; return mrl; }
+        { Mrl mrl; mrl.set(str, QString()); return mrl; }
     static auto fromDisc(const QString &scheme, const QString &device,
                          int title, bool hash) -> Mrl;
     static auto fromCueTrack(const QString &cue, const CueTrack &track,
@@ -59,11 +61,20 @@ public:
     static auto fromUniqueId(const QString &id,
                              const QString &device = QString(),
                              const QString &name = QString()) -> Mrl;
+    // consistent with operator ==, no need to join dir and leaf
+    friend auto qHash(const Mrl &mrl, uint seed = 0) -> uint
+        { return qHash(mrl.d->leaf, qHash(mrl.d->dir, seed)); }
 private:
+    enum Flag { Local = 1, Dvd = 2, Bluray = 4, Cue = 8 };
+    struct Data : public QSharedData {
+        // dir ends with '/' and is shared by all Mrls in the same directory
+        QString dir, leaf, name, display;
+        QByteArray hash;
+        int flags = 0;
+    };
+    auto set(const QString &location, const QString &name) -> void;
     auto path() const -> QString;
-    QString m_loc = {};
-    QString m_name;
-    QByteArray m_hash;
+    QSharedDataPointer<Data> d;
 };
 
 Q_DECLARE_METATYPE(Mrl)
@@ -1,12 +1,43 @@
 #include "mrlstatesqlfield.hpp"
 #include "mrl.hpp"
 #include "misc/jsonstorage.hpp"
+#include "misc/jsonbinary.hpp"
 #include <QSqlQuery>
 #include <QSqlRecord>
 
 template<class T>
 SIA _Is(int type) -> bool { return qMetaTypeId<T>() == type; }
 
+// first byte of binary column which tells version of encoding
+static constexpr char BinaryFormat = 1;
+
+SIA toBinary(const QJsonValue &json) -> QVariant
+{
+    QByteArray data(1, BinaryFormat);
+    _JsonToBinary(json, data);
+    return data;
+}
+
+// text of MrlState::Version 4 or binary of BinaryFormat
+SIA fromBinary(const QVariant &data) -> QJsonValue
+{
+    if (data.userType() == QMetaType::QByteArray) {
+        const auto bytes = data.toByteArray();
+        if (bytes.isEmpty() || bytes[0] != BinaryFormat)
+            return QJsonValue::Undefined;
+        return _JsonFromBinary(bytes, 1);
+    }
+    if (data.userType() != QMetaType::QString)
+        return QJsonValue::Undefined;
+    QJsonParseError e;
+    const auto doc = QJsonDocument::fromJson(data.toString().toUtf8(), &e);
+    if (e.error)
+        return QJsonValue::Undefined;
+    if (doc.isArray())
+        return doc.array();
+    return doc.object();
+}
+
 MrlStateSqlField::MrlStateSqlField(const QMetaProperty &property,
                                    const QVariant &def) noexcept
     : m_property(property)
@@ -61,31 +92,50 @@ MrlStateSqlField::MrlStateSqlField(const QMetaProperty &property,
             };
             break;
         case QJsonValue::Array:
+            m_sqlType = u"BLOB"_q;
             m_v2d = [] (const QVariant &value) -> QVariant
-                { return QString::fromUtf8(QJsonDocument(_JsonFromQVariant(value).toArray()).toJson()); };
+                { return toBinary(_JsonFromQVariant(value).toArray()); };
             m_d2v = [] (const QVariant &data, int type) -> QVariant {
-                QJsonParseError e;
-                const auto doc = QJsonDocument::fromJson(data.toString().toUtf8(), &e);
-                if (e.error || !doc.isArray())
+                const auto json = fromBinary(data);
+                if (!json.isArray())
                     return QVariant();
-                return _JsonToQVariant(doc.array(), type);
+                return _JsonToQVariant(json, type);
             };
+            m_binary = true;
             break;
         case QJsonValue::Object:
+            m_sqlType = u"BLOB"_q;
             m_v2d = [] (const QVariant &value) -> QVariant
-                { return QString::fromUtf8(QJsonDocument(_JsonFromQVariant(value).toObject()).toJson()); };
+                { return toBinary(_JsonFromQVariant(value).toObject()); };
             m_d2v = [] (const QVariant &data, int type) -> QVariant {
-                QJsonParseError e;
-                const auto doc = QJsonDocument::fromJson(data.toString().toUtf8(), &e);
-                if (e.error || !doc.isObject())
+                const auto json = fromBinary(data);
+                if (!json.isObject())
                     return QVariant();
-                return _JsonToQVariant(doc.object(), type);
+                return _JsonToQVariant(json, type);
             };
+            m_binary = true;
             break;
         default:
             Q_ASSERT(false);
         }
     }}
+    if (m_binary)
+        m_defaultData = m_v2d(m_defaultValue);
+}
+
+auto MrlStateSqlField::exportTo(QObject *state, const QVariant &sqlData) const -> bool
+{
+    // most of binary columns keep default value, so skip decoding for them
+    if (m_binary && sqlData == m_defaultData)
+        return m_property.write(state, m_defaultValue);
+    const auto var = m_d2v(sqlData, m_defaultValue.userType());
+    return m_property.write(state, var.isValid() ? var : m_defaultValue);
+}
+
+auto MrlStateSqlField::reencode(const QVariant &sqlData) const -> QVariant
+{
+    const auto var = m_d2v(sqlData, m_defaultValue.userType());
+    return m_v2d(var.isValid() ? var : m_defaultValue);
 }
 
 /******************************************************************************/
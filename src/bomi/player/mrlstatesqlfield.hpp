@@ -15,16 +15,17 @@ struct MrlStateSqlField {
     auto sqlData(T*) const -> void; // error
     auto sqlData(const QVariant &value) const noexcept -> QVariant
     { return m_v2d(value); }
-    auto exportTo(QObject *state, const QVariant &sqlData) const -> bool
-    {
-        const auto var = m_d2v(sqlData, m_defaultValue.userType());
-        return m_property.write(state, var.isValid() ? var : m_defaultValue);
-    }
+    auto exportTo(QObject *state, const QVariant &sqlData) const -> bool;
     auto isValid() const -> bool { return m_v2d && m_d2v; }
+    // json arrays and objects are stored in binary
+    auto isBinary() const -> bool { return m_binary; }
+    // converts data stored in old format into current one
+    auto reencode(const QVariant &sqlData) const -> QVariant;
 private:
     QMetaProperty m_property;
     QString m_sqlType;
-    QVariant m_defaultValue;
+    QVariant m_defaultValue, m_defaultData;
+    bool m_binary = false;
     QVariant(*m_v2d)(const QVariant&) = nullptr;
     QVariant(*m_d2v)(const QVariant&,int) = nullptr;
     friend class MrlStateSqlFieldList;
@@ -393,21 +393,24 @@ auto PlayEngine::setTrackSelected(StreamType type, int id, bool s) -> void
 
 auto PlayEngine::autoloadSubtitleFiles() -> void
 {
-    clearSubtitleFiles();
-    MpvFileList files; QVector<SubComp> loads;
-    d->mutex.lock();
-    _R(files, loads) = d->autoloadSubtitle(&d->params);
-    d->mutex.unlock();
-    for (auto &file : files.names) {
-        d->mpv.setAsync("options/subcp", d->assEncodings[file].name().toLatin1());
-        d->mpv.tellAsync("sub_add", MpvFile(file), "auto"_b);
-    }
-    d->setInclusiveSubtitles(loads);
+    d->autoloadFiles(StreamSubtitle, [=] (const QStringList &subs) {
+        clearSubtitleFiles();
+        MpvFileList files; QVector<SubComp> loads;
+        d->mutex.lock();
+        _R(files, loads) = d->autoloadSubtitle(&d->params, subs);
+        d->mutex.unlock();
+        for (auto &file : files.names) {
+            d->mpv.setAsync("options/subcp", d->assEncodings[file].name().toLatin1());
+            d->mpv.tellAsync("sub_add", MpvFile(file), "auto"_b);
+        }
+        d->setInclusiveSubtitles(loads);
+    });
 }
 
 auto PlayEngine::autoloadAudioFiles() -> void
 {
-    setAudioFiles(d->autoloadFiles(StreamAudio).names);
+    d->autoloadFiles(StreamAudio, [=] (const QStringList &files)
+        { setAudioFiles(files); });
 }
 
 auto PlayEngine::reloadSubtitleFiles(const EncodingInfo &enc, bool detect) -> void
@@ -491,10 +494,24 @@ auto PlayEngine::setSubtitleStyle_locked(const OsdStyle &style) -> void
     d->updateSubtitleStyle();
 }
 
+auto PlayEngine::setSubtitleGlyphRendering_locked(bool on) -> void
+{
+    d->sr->setGlyphRendering(on);
+}
+
+auto PlayEngine::setSubtitlePrerender_locked(int mb, int before, int after) -> void
+{
+    d->sr->setCacheBudget(mb * 1024LL * 1024LL);
+    d->sr->setPrefetchWindow(before, after);
+}
+
 auto PlayEngine::seek(int pos) -> void
 {
-    if (pos >= 0 && !d->hasImage)
+    if (pos >= 0 && !d->hasImage) {
+        Trace::instant("seek", pos);
+        d->frames.resets.ref();
         d->mpv.tell("seek", (std::max(d->begin, pos) + d->t.offset)/1000.0, "absolute"_b);
+    }
     d->vp->stopSkipping();
 }
 
@@ -503,6 +520,8 @@ auto PlayEngine::relativeSeek(int pos) -> void
     if (!d->hasImage) {
         if (pos < d->begin - d->time)
             pos = d->begin - d->time;
+        Trace::instant("relative seek", pos);
+        d->frames.resets.ref();
         d->mpv.tell("seek", pos/1000.0, "relative"_b);
         emit sought();
     }
@@ -152,6 +152,9 @@ public:
     auto lock() -> void;
     auto setHwAcc_locked(bool use, const QList<CodecId> &codecs) -> void;
     auto setSubtitleStyle_locked(const OsdStyle &style) -> void;
+    auto setSubtitleGlyphRendering_locked(bool on) -> void;
+    // cache budget in MiB and prefetch window in msec
+    auto setSubtitlePrerender_locked(int mb, int before, int after) -> void;
     auto setAutoselectMode_locked(bool enable, AutoselectMode mode,
                                   const QString &ext, bool preferExternal) -> void;
     auto setCache_locked(const CacheInfo &info) -> void;
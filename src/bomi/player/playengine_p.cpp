@@ -2,6 +2,9 @@
 #include <QQmlEngine>
 #include <QTextCodec>
 
+// frame interval longer than this in nsec is recorded as stall
+static constexpr qint64 StallThreshold = 250 * 1000 * 1000;
+
 template<class T>
 SIA findEnum(const QString &mpv) -> T
 {
@@ -802,8 +805,7 @@ auto PlayEngine::Data::process(QEvent *event) -> void
         emit p->editionChanged();
         emit p->started(params.mrl());
         if (params.set_name(mpv.get<MpvUtf8>("media-title").data))
-            history->update(&params, u"name"_q, false);
-        history->update();
+            history->update(&params, u"name"_q);
         break;
     } case EndPlayback: {
         QSharedPointer<MrlState> last; int reason, error;
@@ -828,7 +830,7 @@ auto PlayEngine::Data::process(QEvent *event) -> void
             break;
         }
         updateState(state);
-        history->update(last.data(), false);
+        history->update(last.data());
         emit p->finished(last->mrl(), eof);
         break;
     } case NotifySeek:
@@ -848,7 +850,7 @@ auto PlayEngine::Data::process(QEvent *event) -> void
         mutex.unlock();
         params.m_mutex = &mutex;
         emit p->endSyncMrlState();
-        history->update(&params, false);
+        history->update(&params);
 
         qDeleteAll(info.streamings);
         info.streamings.clear();
@@ -883,8 +885,18 @@ auto PlayEngine::Data::takeSnapshot() -> void
 
 auto PlayEngine::Data::renderVideoFrame(Fbo *frame, Fbo *osd, const QMargins &m) -> void
 {
+    TraceScope trace("render frame", frames.drawn + 1);
     info.delayed = mpv.render(frame, osd, m);
     frames.measure.push(++frames.drawn);
+    if (Trace::isEnabled()) {
+        const auto now = Trace::now();
+        const int reset = frames.resets.load();
+        if (reset == frames.reset && state == PlayEngine::Playing
+                && now - frames.traced > StallThreshold)
+            Trace::stall("render stall", now - frames.traced);
+        frames.reset = reset;
+        frames.traced = now;
+    }
 
     _Trace("PlayEngine::Data::renderVideoFrame(): "
            "render queued frame(%%), avgfps: %%",
@@ -950,6 +962,21 @@ auto PlayEngine::Data::autoloadFiles(StreamType type) -> MpvFileList
     return a.autoload(mrl, streams[type].ext);
 }
 
+auto PlayEngine::Data::autoloadFiles(StreamType type,
+                                     std::function<void(const QStringList&)> &&done) -> void
+{
+    mutex.lock();
+    const auto a = streams[type].autoloader;
+    const auto ext = streams[type].ext;
+    mutex.unlock();
+    const auto mrl = this->mrl;
+    // ignore result for previous file
+    a.autoload(mrl, ext, p, [=] (const QStringList &files) {
+        if (this->mrl == mrl)
+            done(files);
+    });
+}
+
 auto PlayEngine::Data::autoselect(const MrlState *s, QVector<SubComp> &loads) -> void
 {
     QVector<int> selected;
@@ -1035,6 +1062,7 @@ auto PlayEngine::Data::updateState(State s) -> void
 {
     const auto prev = state;
     if (_Change(state, s)) {
+        frames.resets.ref();
         emit p->stateChanged(state);
         auto check = [&] (State s)
             { return !!(state & s) != !!(prev & s); };
@@ -14,6 +14,7 @@
 #include "misc/speedmeasure.hpp"
 #include "misc/yledl.hpp"
 #include "misc/charsetdetector.hpp"
+#include "misc/trace.hpp"
 #include "audio/audiocontroller.hpp"
 #include "audio/audioformat.hpp"
 #include "video/videorenderer.hpp"
@@ -130,6 +131,10 @@ struct PlayEngine::Data {
     struct {
         quint64 drawn = 0, dropped = 0, delayed = 0;
         SpeedMeasure<quint64> measure{5, 20};
+        // gap across seek or state change is not a stall
+        QAtomicInt resets = 0;
+        int reset = 0;
+        qint64 traced = 0;
     } frames;
 
     struct { QImage osd, frame; bool take = false; int time = 0; } ss;
@@ -152,7 +157,11 @@ struct PlayEngine::Data {
         { mpv.tellAsync("audio_add", MpvFile(file), select ? "select"_b : "auto"_b); }
     auto sub_add(const QString &file, const EncodingInfo &enc, bool select) -> void;
     auto autoselect(const MrlState *s, QVector<SubComp> &loads) -> void;
+    // blocking, for hook of mpv
     auto autoloadFiles(StreamType type) -> MpvFileList;
+    // lists directories in background and calls done in GUI thread
+    auto autoloadFiles(StreamType type,
+                       std::function<void(const QStringList&)> &&done) -> void;
     auto autoloadSubtitle(const MrlState *s) -> T<MpvFileList, QVector<SubComp>>;
     auto autoloadSubtitle(const MrlState *s, const MpvFileList &files) -> T<MpvFileList, QVector<SubComp>>;
 
@@ -25,14 +25,10 @@ public:
     static auto guessType(const QString &fileName) -> Type;
     static auto typeForSuffix(const QString &suffix) -> Type;
 private:
-    static auto resolve(const QString &location, const QUrl &url) -> QString;
     auto savePLS(QTextStream &out) const -> bool;
     auto saveM3U(QTextStream &out) const -> bool;
     auto load(QTextStream &in, const EncodingInfo &enc, Type type,
               const QUrl &url = QUrl()) -> bool;
-    auto loadPLS(QTextStream &in, const QUrl &url = QUrl()) -> bool;
-    auto loadM3U(QTextStream &in, const QUrl &url = QUrl()) -> bool;
-    auto loadCue(QTextStream &in, const QUrl &url = QUrl()) -> bool;
 };
 
 Q_DECLARE_METATYPE(Playlist)
@@ -1,20 +1,113 @@
 #include "playlistmodel.hpp"
 #include "misc/downloader.hpp"
 #include "misc/encodinginfo.hpp"
+#include "playlistreader.hpp"
 #include <random>
 #include <chrono>
 #include <QQuickItem>
 
 PlaylistModel::PlaylistModel(QObject *parent)
-: Super(parent) {
+: SimpleListModelBase(1, parent) {
     connect(this, &PlaylistModel::modelReset, this, &PlaylistModel::contentWidthChanged);
     connect(this, &PlaylistModel::rowsChanged, this, &PlaylistModel::countChanged);
     connect(this, &PlaylistModel::specialRowChanged, this, &PlaylistModel::loadedChanged);
     connect(this, &PlaylistModel::loadedChanged, this, &PlaylistModel::nextChanged);
+    connect(this, &PlaylistModel::rowsChanged, this, [=] (int rows) {
+        m_digits = 0;
+        do {
+            ++m_digits;
+            rows = rows/10;
+        } while (rows);
+    });
 }
 
 PlaylistModel::~PlaylistModel() {}
 
+auto PlaylistModel::setList(const Playlist &list) -> void
+{
+    if (m_loader)
+        m_loader->cancel();
+    m_loader = nullptr;
+    beginResetModel();
+    m_list = list;
+    m_names = m_locations = QVector<QString>(m_list.size());
+    invalidate();
+    reset(m_list.size());
+    endResetModel();
+}
+
+auto PlaylistModel::append(const Playlist &list) -> void
+{
+    if (list.isEmpty())
+        return;
+    const int at = m_list.size();
+    beginInsertRows(QModelIndex(), at, at + list.size() - 1);
+    m_list += list;
+    m_names.resize(m_list.size());
+    m_locations.resize(m_list.size());
+    if (!m_rows.isEmpty()) {
+        for (int i = at; i < m_list.size(); ++i) {
+            if (!m_rows.contains(m_list[i]))
+                m_rows.insert(m_list[i], i);
+        }
+    }
+    resize(m_list.size());
+    endInsertRows();
+}
+
+auto PlaylistModel::invalidate() -> void
+{
+    m_rows.clear();
+    m_shuffledIdx.clear();
+    m_shuffledPos.clear();
+}
+
+auto PlaylistModel::removeAll() -> void
+{
+    m_list.clear();
+    m_names.clear();
+    m_locations.clear();
+    invalidate();
+}
+
+auto PlaylistModel::insertAt(int row, int count) -> void
+{
+    for (int i = 0; i < count; ++i)
+        m_list.insert(row, Mrl());
+    m_names.insert(row, count, QString());
+    m_locations.insert(row, count, QString());
+    invalidate();
+}
+
+auto PlaylistModel::removeAt(int row, int count) -> void
+{
+    m_list.erase(m_list.begin() + row, m_list.begin() + row + count);
+    m_names.remove(row, count);
+    m_locations.remove(row, count);
+    invalidate();
+}
+
+auto PlaylistModel::swapAt(int r1, int r2) -> bool
+{
+    if (!isValidRow(r1) || !isValidRow(r2) || r1 == r2)
+        return false;
+    m_list.swap(r1, r2);
+    std::swap(m_names[r1], m_names[r2]);
+    std::swap(m_locations[r1], m_locations[r2]);
+    m_rows.clear();
+    return true;
+}
+
+auto PlaylistModel::rowOf(const Mrl &mrl) const -> int
+{
+    if (m_rows.isEmpty()) {
+        m_rows.reserve(m_list.size());
+        for (int i = m_list.size() - 1; i >= 0; --i)
+            m_rows.insert(m_list[i], i);
+    }
+    return m_rows.value(mrl, -1);
+}
+
 auto PlaylistModel::next() const -> int
 {
     if (isEmpty())
@@ -23,7 +116,7 @@ auto PlaylistModel::next() const -> int
         return (loaded() >= rows() - 1 && m_repeat) ? 0 : loaded() + 1;
     if (m_shuffledIdx.size() != rows())
         shuffle();
-    const int find = m_shuffledIdx.indexOf(loaded());
+    const int find = m_shuffledPos.value(loaded(), -1);
     if (find == -1)
         return m_shuffledIdx.first();
     if (find < m_shuffledIdx.size() - 1)
@@ -42,7 +135,7 @@ auto PlaylistModel::previous() const -> int
         return (loaded() <= 0 && m_repeat) ? rows() - 1 : loaded() - 1;
     if (m_shuffledIdx.size() != rows())
         shuffle();
-    const int find = m_shuffledIdx.indexOf(loaded());
+    const int find = m_shuffledPos.value(loaded(), -1);
     if (find == -1)
         return m_shuffledIdx.first();
     if (find > 0)
@@ -57,17 +150,21 @@ auto PlaylistModel::shuffle() const -> void
 {
     if (!m_shuffled) {
         m_shuffledIdx.clear();
+        m_shuffledPos.clear();
         return;
     }
     m_shuffledIdx.resize(rows());
     for (int i = 0; i < m_shuffledIdx.size(); ++i)
         m_shuffledIdx[i] = i;
-    if (m_shuffledIdx.size() < 2 || !m_shuffled)
-        return;
-    using namespace std; using std::chrono::system_clock;
-    static const auto seed = system_clock::now().time_since_epoch().count();
-    std::shuffle(m_shuffledIdx.begin(), m_shuffledIdx.end(),
-                 default_random_engine(seed));
+    if (m_shuffledIdx.size() > 1) {
+        using namespace std; using std::chrono::system_clock;
+        static const auto seed = system_clock::now().time_since_epoch().count();
+        std::shuffle(m_shuffledIdx.begin(), m_shuffledIdx.end(),
+                     default_random_engine(seed));
+    }
+    m_shuffledPos.resize(m_shuffledIdx.size());
+    for (int i = 0; i < m_shuffledIdx.size(); ++i)
+        m_shuffledPos[m_shuffledIdx[i]] = i;
 }
 
 auto PlaylistModel::setShuffled(bool shuffled) -> void
@@ -96,12 +193,7 @@ auto PlaylistModel::number(int row) const -> QString
 {
     if (m_fill.isNull())
         return QString::number(row+1);
-    int digits = 0, left = rows();
-    do {
-        ++digits;
-        left = left/10;
-    } while (left);
-    return _N(row+1, 10, digits, m_fill);
+    return _N(row+1, 10, m_digits, m_fill);
 }
 
 auto PlaylistModel::play(int row) -> void
@@ -110,10 +202,26 @@ auto PlaylistModel::play(int row) -> void
         emit playRequested(row);
 }
 
+auto PlaylistModel::name(int row) const -> QString
+{
+    if (!isValidRow(row))
+        return QString();
+    auto &name = m_names[row];
+    if (name.isNull())
+        name = m_list[row].displayName();
+    return name;
+}
+
 auto PlaylistModel::location(int row) const -> QString
 {
-    auto mrl = value(row);
-    return mrl.isLocalFile() ? mrl.toLocalFile() : mrl.toString();
+    if (!isValidRow(row))
+        return QString();
+    auto &location = m_locations[row];
+    if (location.isNull()) {
+        const auto &mrl = m_list[row];
+        location = mrl.isLocalFile() ? mrl.toLocalFile() : mrl.toString();
+    }
+    return location;
 }
 
 auto PlaylistModel::roleData(int row, int, int role) const -> QVariant
@@ -157,12 +265,34 @@ auto PlaylistModel::setDownloader(Downloader *downloader) -> void
         auto data = m_downloader->takeData();
         const auto suffix = m_downloader->suffixes().value(0);
         const auto type = Playlist::typeForSuffix(suffix);
-        Playlist list;
-        if (list.load(m_downloader->url(), &data, m_enc, type)) {
-            setList(list);
-            setVisible(true);
-        }
+        load(new PlaylistLoader(m_downloader->url(), data, m_enc, type), false);
+        setVisible(true);
+    });
+}
+
+auto PlaylistModel::load(const Mrl &mrl, const EncodingInfo &enc, bool start) -> void
+{
+    if (mrl.isLocalFile())
+        load(new PlaylistLoader(mrl.toLocalFile(), enc), start);
+}
+
+auto PlaylistModel::load(PlaylistLoader *loader, bool start) -> void
+{
+    setList(Playlist());
+    m_loader = loader;
+    connect(loader, &PlaylistLoader::loaded, this, [=] (const Playlist &entries) {
+        if (m_loader != loader)
+            return;
+        const bool first = isEmpty();
+        append(entries);
+        if (first && start)
+            play(0);
+    });
+    connect(loader, &PlaylistLoader::finished, this, [=] () {
+        if (m_loader == loader)
+            m_loader = nullptr;
     });
+    loader->start();
 }
 
 auto PlaylistModel::open(const QString &mrl) -> void
@@ -183,7 +313,7 @@ auto PlaylistModel::add(const QString &mrl) -> void
 auto PlaylistModel::open(const Mrl &mrl, const EncodingInfo &enc) -> void
 {
     if (mrl.isLocalFile()) {
-        setList({mrl, enc});
+        load(mrl, enc);
         setVisible(true);
     } else {
         if (m_downloader->isRunning())
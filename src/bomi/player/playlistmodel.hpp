@@ -5,8 +5,10 @@
 #include "misc/simplelistmodel.hpp"
 
 class Downloader;                       class EncodingInfo;
+class PlaylistLoader;
 
-class PlaylistModel : public SimpleListModel<Mrl, Playlist> {
+// rows are stored by columns so that strings for views are built once
+class PlaylistModel : public SimpleListModelBase {
     Q_OBJECT
     Q_PROPERTY(int loaded READ loaded NOTIFY loadedChanged)
     Q_PROPERTY(int count READ rows NOTIFY countChanged)
@@ -24,6 +26,13 @@ public:
     PlaylistModel(QObject *parent = 0);
     ~PlaylistModel();
 
+    auto at(int row) const -> const Mrl& { return m_list.at(row); }
+    auto value(int row) const -> Mrl { return m_list.value(row); }
+    auto list() const -> const Playlist& { return m_list; }
+    auto setList(const Playlist &list) -> void;
+    auto append(const Mrl &mrl) -> void { append(Playlist(mrl)); }
+    auto append(const Playlist &list) -> void;
+    auto rowOf(const Mrl &mrl) const -> int;
     auto roleData(int row, int column, int role) const -> QVariant final;
     auto loaded() const -> int { return specialRow(); }
     auto currentNumber() const -> int { return specialRow() + 1; }
@@ -41,12 +50,14 @@ public:
     auto isShuffled() const -> bool { return m_shuffled; }
     auto selected() const -> int { return m_selected; }
     auto repeat() const -> bool { return m_repeat; }
-    Q_INVOKABLE QString name(int row) const {return value(row).displayName();}
+    Q_INVOKABLE QString name(int row) const;
     Q_INVOKABLE QString location(int row) const;
     Q_INVOKABLE QString number(int row) const;
     Q_INVOKABLE bool isLoaded(int row) const {return loaded() == row;}
 
     auto open(const Mrl &mrl, const EncodingInfo &enc) -> void;
+    // replaces list with entries of local playlist file as they are parsed
+    auto load(const Mrl &mrl, const EncodingInfo &enc, bool start = false) -> void;
     Q_INVOKABLE void open(const QString &mrl);
     Q_INVOKABLE void open(const QString &mrl, const QString &enc);
     Q_INVOKABLE void add(const QString &mrl);
@@ -78,14 +89,28 @@ signals:
 private:
     friend class PlayEngine;
     auto setLoaded(int row) -> void;
+    auto load(PlaylistLoader *loader, bool start) -> void;
     auto shuffle() const -> void;
+    auto invalidate() -> void;
+    auto removeAll() -> void final;
+    auto insertAt(int row, int count) -> void final;
+    auto removeAt(int row, int count) -> void final;
+    auto swapAt(int r1, int r2) -> bool final;
+    Playlist m_list;
+    // null until requested
+    mutable QVector<QString> m_names, m_locations;
+    // first row for each location, built on demand
+    mutable QHash<Mrl, int> m_rows;
+    int m_digits = 1;
     QChar m_fill = QChar::Null;
     bool m_visible = false;
     int m_selected = -1;
     Downloader *m_downloader = nullptr;
+    QPointer<PlaylistLoader> m_loader;
     EncodingInfo m_enc;
     bool m_shuffled = false, m_repeat = false;
-    mutable QVector<int> m_shuffledIdx;
+    // m_shuffledPos[row] is the position of row in m_shuffledIdx
+    mutable QVector<int> m_shuffledIdx, m_shuffledPos;
 };
 
 inline auto PlaylistModel::setFillChar(QChar c) -> void
@@ -0,0 +1,327 @@
+#include "playlistreader.hpp"
+#include "misc/log.hpp"
+#include <QTextStream>
+#include <QBuffer>
+#include <QThreadPool>
+
+DECLARE_LOG_CONTEXT(Playlist)
+
+// enough to detect encoding of any sane playlist
+static constexpr int DetectionLength = 64 * 1024;
+// first chunk is small to show and play the first entry as soon as possible
+static constexpr int FirstChunk = 64, MaxChunk = 4096;
+
+SIA resolve(const QString &location, const QUrl &url) -> QString
+{
+    if (url.isEmpty() || location.indexOf("://"_a) > 0)
+        return location;
+    const QFileInfo info(location);
+    if (info.isAbsolute())
+        return location;
+    const auto str = url.toString();
+    const auto idx = str.lastIndexOf('/'_q);
+    if (idx < 0)
+        return location;
+    return str.left(idx + 1) % location;
+}
+
+struct CueTrack {
+    QString title, writer, performer, file;
+    int idx00 = -1, idx01 = -1;
+    auto toMrl(const QString &cue, const CueTrack *next) const -> Mrl
+    {
+        Mrl::CueTrack track;
+        track.file = file;
+        track.start = idx01;
+        if (next)
+            track.end = next->idx00 != -1 ? next->idx00 : next->idx01;
+        QString name;
+        if (!title.isEmpty())
+            name += title;
+        if (!performer.isEmpty()) {
+            if (!name.isEmpty())
+                name += " - "_a;
+            name += performer;
+        }
+        return Mrl::fromCueTrack(cue, track, name);
+    }
+};
+
+static auto loadCue(QTextStream &in, const QUrl &url, Playlist &list) -> bool
+{
+    CueTrack init;
+    CueTrack *current = &init;
+    QRegEx rxField(uR"#(^(\w+)\s+(.*)\s*$)#"_q);
+    QRegEx rxText(uR"#(^\s*"(.*)"\s*$)#"_q);
+    QRegEx rxFile(uR"#(^\s*"(.*)"\s+\w+\s*$)#"_q);
+    QRegEx rxIndex(uR"(^\s*(\d\d)\s+(\d\d):(\d\d):(\d\d)\s*$)"_q);
+    QVector<CueTrack> tracks;
+    while (!in.atEnd()) {
+        const auto line = in.readLine().trimmed();
+        auto m = rxField.match(line);
+        if (!m.hasMatch())
+            continue;
+        const auto key = m.captured(1);
+        if (key == "REM"_a)
+            continue;
+        const auto value = m.captured(2);
+        if (key == "TRACK"_a) {
+            tracks.push_back(*current);
+            current = &tracks.last();
+            current->idx00 = current->idx01 = -1;
+            continue;
+        }
+        if (key == "FILE"_a) {
+            m = rxFile.match(value);
+            if (!m.hasMatch())
+                return false;
+            current->file = resolve(m.captured(1), url);
+            continue;
+        }
+        if (key == "INDEX"_a) {
+            m = rxIndex.match(value);
+            if (!m.hasMatch())
+                return false;
+            const auto idx = m.capturedRef(1).toInt();
+            const auto min = m.capturedRef(2).toInt();
+            const auto sec = m.capturedRef(3).toInt()
+                    + m.capturedRef(4).toInt() / 75.0;
+            const auto msec = (min * 60 + sec) * 1000;
+            if (idx == 1)
+                current->idx01 = msec;
+            else if (idx == 0)
+                current->idx00 = msec;
+            continue;
+        }
+#define TEST_TEXT(name, var) \
+        if (key == name) { \
+            m = rxText.match(value); \
+            if (!m.hasMatch()) \
+                return false; \
+            var = m.captured(1); \
+            continue; \
+        }
+        TEST_TEXT("TITLE"_a, current->title);
+        TEST_TEXT("PERFORMER"_a, current->performer);
+        TEST_TEXT("SONGWRITER"_a, current->writer);
+#undef TEST_TEXT
+    }
+
+    const auto cue = url.toLocalFile();
+    list.reserve(list.size() + tracks.size());
+    for (int i = 0; i < tracks.size(); ++i) {
+        const auto next = i + 1 < tracks.size() ? &tracks[i+1] : nullptr;
+        list.push_back(tracks[i].toMrl(cue, next));
+    }
+    return true;
+}
+
+/******************************************************************************/
+
+struct PlaylistReader::Data {
+    QTextStream *in = nullptr;
+    Playlist::Type type = Playlist::Unknown;
+    QUrl url;
+    bool valid = true, done = false;
+    QRegEx rxFile{uR"(^File\d+=(.+)$)"_q};
+    QRegEx rxExtInf{uR"(#EXTINF\s*:\s*(?<num>(-|)\d+)[^,]*,\s*(?<name>.*)\s*$)"_q};
+    auto readPLS(Playlist &list, int max) -> int
+    {
+        int count = 0;
+        while (count < max && !in->atEnd()) {
+            const QString line = in->readLine();
+            if (line.isEmpty())
+                continue;
+            const auto match = rxFile.match(line);
+            if (match.hasMatch()) {
+                list.push_back(Mrl(resolve(match.captured(1), url)));
+                ++count;
+            }
+        }
+        return count;
+    }
+    auto nextLocation() -> QString
+    {
+        while (!in->atEnd()) {
+            const QString line = in->readLine().trimmed();
+            if (!line.isEmpty() && !line.startsWith('#'_q))
+                return line;
+        }
+        return QString();
+    }
+    auto readM3U(Playlist &list, int max) -> int
+    {
+        int count = 0;
+        while (count < max && !in->atEnd()) {
+            const QString line = in->readLine().trimmed();
+            if (line.isEmpty())
+                continue;
+            QString name, location;
+            if (line.startsWith('#'_q)) {
+                auto matched = rxExtInf.match(line);
+                if (matched.hasMatch()) {
+                    name = matched.captured(u"name"_q);
+                    location = nextLocation();
+                }
+            } else
+                location = line;
+            if (!location.isEmpty()) {
+                list.push_back(Mrl(resolve(location, url), name));
+                ++count;
+            }
+        }
+        return count;
+    }
+};
+
+PlaylistReader::PlaylistReader(QTextStream &in, Playlist::Type type, const QUrl &url)
+    : d(new Data)
+{
+    d->in = &in;
+    d->type = type;
+    d->url = url;
+}
+
+PlaylistReader::~PlaylistReader()
+{
+    delete d;
+}
+
+auto PlaylistReader::atEnd() const -> bool
+{
+    return d->done;
+}
+
+auto PlaylistReader::isValid() const -> bool
+{
+    return d->valid;
+}
+
+auto PlaylistReader::read(Playlist &list, int max) -> int
+{
+    if (d->done)
+        return 0;
+    int count = 0;
+    switch (d->type) {
+    case Playlist::PLS:
+        count = d->readPLS(list, max);
+        break;
+    case Playlist::M3U:
+    case Playlist::M3U8:
+        count = d->readM3U(list, max);
+        break;
+    case Playlist::Cue: {
+        const int size = list.size();
+        d->valid = loadCue(*d->in, d->url, list);
+        d->done = true;
+        return list.size() - size;
+    } default:
+        d->valid = false;
+        d->done = true;
+        return 0;
+    }
+    d->done = d->in->atEnd();
+    return count;
+}
+
+auto PlaylistReader::encoding(QIODevice *device, Playlist::Type type,
+                              const EncodingInfo &enc) -> EncodingInfo
+{
+    if (type == Playlist::M3U8)
+        return EncodingInfo::utf8();
+    if (enc.isValid() || !device)
+        return enc;
+    return EncodingInfo::detect(EncodingInfo::Playlist, device->peek(DetectionLength));
+}
+
+/******************************************************************************/
+
+struct PlaylistLoader::Data {
+    QString path;
+    QUrl url;
+    QByteArray data;
+    EncodingInfo enc;
+    Playlist::Type type = Playlist::Unknown;
+    QAtomicInt canceled = 0;
+};
+
+PlaylistLoader::PlaylistLoader(const QString &filePath, const EncodingInfo &enc,
+                               Playlist::Type type)
+    : d(new Data)
+{
+    qRegisterMetaType<Playlist>();
+    d->path = filePath;
+    d->url = _UrlFromLocalFile(filePath);
+    d->enc = enc;
+    d->type = type == Playlist::Unknown ? Playlist::guessType(filePath) : type;
+}
+
+PlaylistLoader::PlaylistLoader(const QUrl &url, const QByteArray &data,
+                               const EncodingInfo &enc, Playlist::Type type)
+    : d(new Data)
+{
+    qRegisterMetaType<Playlist>();
+    d->url = url;
+    d->data = data;
+    d->enc = enc;
+    d->type = type;
+}
+
+PlaylistLoader::~PlaylistLoader()
+{
+    delete d;
+}
+
+auto PlaylistLoader::start() -> void
+{
+    class Job : public QRunnable {
+    public:
+        Job(PlaylistLoader *loader): m_loader(loader) { }
+        auto run() -> void override { m_loader->run(); }
+    private:
+        PlaylistLoader *m_loader;
+    };
+    QThreadPool::globalInstance()->start(new Job(this));
+}
+
+auto PlaylistLoader::cancel() -> void
+{
+    d->canceled.store(1);
+}
+
+auto PlaylistLoader::isCanceled() const -> bool
+{
+    return d->canceled.load();
+}
+
+auto PlaylistLoader::run() -> void
+{
+    QFile file;
+    QBuffer buffer;
+    QIODevice *device = &buffer;
+    if (d->path.isEmpty())
+        buffer.setData(d->data);
+    else {
+        file.setFileName(d->path);
+        device = &file;
+    }
+    bool ok = device->open(QIODevice::ReadOnly);
+    if (ok) {
+        const auto enc = PlaylistReader::encoding(device, d->type, d->enc);
+        QTextStream in(device);
+        if (enc.isValid())
+            in.setCodec(enc.codec());
+        PlaylistReader reader(in, d->type, d->url);
+        int chunk = FirstChunk;
+        while (!reader.atEnd() && !isCanceled()) {
+            Playlist entries;
+            if (reader.read(entries, chunk) > 0)
+                emit loaded(entries);
+            chunk = qMin(chunk * 4, MaxChunk);
+        }
+        ok = reader.isValid();
+    } else
+        _Error("Cannot open playlist: %%", d->path);
+    emit finished(ok && !isCanceled());
+    deleteLater();
+}
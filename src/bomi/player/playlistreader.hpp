@@ -0,0 +1,49 @@
+#ifndef PLAYLISTREADER_HPP
+#define PLAYLISTREADER_HPP
+
+#include "playlist.hpp"
+
+class QTextStream;
+
+// parses entries of playlist by chunks from current position of stream
+class PlaylistReader {
+public:
+    PlaylistReader(QTextStream &in, Playlist::Type type, const QUrl &url = QUrl());
+    ~PlaylistReader();
+    auto atEnd() const -> bool;
+    // false for unknown type or malformed cue sheet
+    auto isValid() const -> bool;
+    // appends at most max entries and returns the number of them
+    // cue sheet is read at once because a track ends where next one starts
+    auto read(Playlist &list, int max) -> int;
+    // detects from head of device without consuming it if enc is invalid
+    static auto encoding(QIODevice *device, Playlist::Type type,
+                         const EncodingInfo &enc) -> EncodingInfo;
+private:
+    struct Data;
+    Data *d;
+};
+
+// reads playlist in worker thread and delivers entries as they are parsed
+// connect signals and then start() it; deletes itself after finished()
+class PlaylistLoader : public QObject {
+    Q_OBJECT
+public:
+    PlaylistLoader(const QString &filePath, const EncodingInfo &enc,
+                   Playlist::Type type = Playlist::Unknown);
+    PlaylistLoader(const QUrl &url, const QByteArray &data,
+                   const EncodingInfo &enc, Playlist::Type type);
+    ~PlaylistLoader();
+    auto start() -> void;
+    auto cancel() -> void;
+    auto isCanceled() const -> bool;
+signals:
+    void loaded(const Playlist &entries);
+    void finished(bool ok);
+private:
+    auto run() -> void;
+    struct Data;
+    Data *d;
+};
+
+#endif // PLAYLISTREADER_HPP
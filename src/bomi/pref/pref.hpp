@@ -113,6 +113,10 @@ private:
     P0(int, ms_per_char, 500)
     P0(OsdStyle, sub_style, {})
     P0(bool, sub_prefer_external, true)
+    P0(bool, sub_glyph_rendering, false)
+    P0(int, sub_cache_mb, 64)
+    P0(int, sub_prefetch_before_ms, 3000)
+    P0(int, sub_prefetch_after_ms, 10000)
 
     P0(bool, enable_system_tray, true)
     P0(bool, hide_rather_close, true)
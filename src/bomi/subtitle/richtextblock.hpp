@@ -24,6 +24,7 @@ struct RichTextBlock {
         }
         Style style;
         int begin, end;
+        DECL_EQ(Format, &T::style, &T::begin, &T::end)
     };
     struct Ruby;
     auto hasWords() const -> bool
@@ -34,6 +35,9 @@ struct RichTextBlock {
         }
         return false;
     }
+    auto operator == (const RichTextBlock &rhs) const -> bool;
+    auto operator != (const RichTextBlock &rhs) const -> bool
+        { return !operator == (rhs); }
     QVector<Format> formats;
     QString text;
     bool paragraph;
@@ -43,8 +47,15 @@ struct RichTextBlock {
 struct RichTextBlock::Ruby {
     int rb_begin = -1, rb_end = -1;
     RichTextBlock rt_block;
+    DECL_EQ(Ruby, &T::rb_begin, &T::rb_end, &T::rt_block)
 };
 
+inline auto RichTextBlock::operator == (const RichTextBlock &rhs) const -> bool
+{
+    return paragraph == rhs.paragraph && text == rhs.text
+            && formats == rhs.formats && rubies == rhs.rubies;
+}
+
 class RichTextBlockParser : public RichTextHelper {
 public:
     RichTextBlockParser(const QStringRef &text);
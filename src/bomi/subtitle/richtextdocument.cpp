@@ -27,6 +27,7 @@ RichTextDocument::~RichTextDocument()
 
 auto RichTextDocument::freeLayouts() -> void
 {
+    m_outline = QPainterPath();
     for (auto &layout : m_layouts) {
         qDeleteAll(layout->rubies);
         _Delete(layout);
@@ -147,6 +148,7 @@ auto RichTextDocument::doLayout(double maxWidth) -> void
     double width = -1;
     const int px = m_format.intProperty(QTextFormat::FontPixelSize);
     m_boxes.clear();
+    m_outline = QPainterPath();
     QPointF pos(0, 0);
     for (int i=0; i<m_layouts.size(); ++i) {
         auto &block = m_layouts[i]->block;
@@ -288,7 +290,7 @@ auto RichTextDocument::updateLayoutInfo() -> void
     m_blockChanged = m_formatChanged = m_pxChanged = m_optionChanged = false;
 }
 
-auto RichTextDocument::draw(QPainter *painter, const QPointF &pos) -> void
+auto RichTextDocument::draw(QPainter *painter, const QPointF &pos) const -> void
 {
     for (auto layout : m_layouts) {
         layout->block.draw(painter, pos);
@@ -297,6 +299,83 @@ auto RichTextDocument::draw(QPainter *painter, const QPointF &pos) -> void
     }
 }
 
+auto RichTextDocument::drawOutline(QPainter *painter, const QPointF &pos,
+                                   const QPen &pen) const -> void
+{
+    if (pen.style() == Qt::NoPen)
+        return;
+    if (m_outline.isEmpty()) {
+        for (auto &run : glyphRuns()) {
+            const auto font = run.glyphs.rawFont();
+            const auto indexes = run.glyphs.glyphIndexes();
+            const auto positions = run.glyphs.positions();
+            for (int i = 0; i < indexes.size(); ++i)
+                m_outline.addPath(font.pathForGlyph(indexes[i])
+                                  .translated(positions[i]));
+            if (positions.isEmpty())
+                continue;
+            // decoration lines at the same place as QPainter draws them
+            const auto rect = run.glyphs.boundingRect();
+            const auto y = positions.first().y();
+            const auto thickness = qMax<qreal>(1.0, font.lineThickness());
+            auto addLine = [&] (qreal center) {
+                m_outline.addRect(rect.left(), center - thickness*0.5,
+                                  rect.width(), thickness);
+            };
+            if (run.glyphs.underline())
+                addLine(y + font.underlinePosition());
+            if (run.glyphs.overline())
+                addLine(y - font.ascent());
+            if (run.glyphs.strikeOut())
+                addLine(y - font.ascent()/3.0);
+        }
+        m_outline.setFillRule(Qt::WindingFill);
+    }
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->translate(pos);
+    painter->strokePath(m_outline, pen);
+    painter->restore();
+}
+
+auto RichTextDocument::glyphRuns() const -> QVector<GlyphRun>
+{
+    QVector<GlyphRun> runs;
+    const auto color = m_format.foreground().color();
+    auto append = [&] (const QTextLayout *layout, int from, int length,
+                       const QTextCharFormat *format) {
+        if (length <= 0)
+            return;
+        GlyphRun run;
+        run.color = format && format->hasProperty(QTextFormat::ForegroundBrush)
+                    ? format->foreground().color() : color;
+        for (auto &glyphs : layout->glyphRuns(from, length)) {
+            run.glyphs = glyphs;
+            runs.push_back(run);
+        }
+    };
+    auto collect = [&] (const QTextLayout *layout) {
+        auto ranges = layout->additionalFormats();
+        std::sort(ranges.begin(), ranges.end(), [] (const QTextLayout::FormatRange &lhs,
+                                                    const QTextLayout::FormatRange &rhs)
+            { return lhs.start < rhs.start; });
+        int pos = 0;
+        for (auto &range : ranges) {
+            append(layout, pos, range.start - pos, nullptr);
+            const int from = qMax(pos, range.start);
+            append(layout, from, range.start + range.length - from, &range.format);
+            pos = qMax(pos, range.start + range.length);
+        }
+        append(layout, pos, layout->text().size() - pos, nullptr);
+    };
+    for (auto layout : m_layouts) {
+        collect(&layout->block);
+        for (auto ruby : layout->rubies)
+            collect(ruby);
+    }
+    return runs;
+}
+
 auto RichTextDocument::drawBoudingBoxes(QPainter *painter,
                                         const QPointF &pos) -> void
 {
@@ -4,9 +4,11 @@
 #include "richtextblock.hpp"
 #include "richtexthelper.hpp"
 #include <QTextLayout>
+#include <QGlyphRun>
 
 class RichTextDocument : public RichTextHelper {
 public:
+    struct GlyphRun { QGlyphRun glyphs; QColor color; };
     RichTextDocument();
     RichTextDocument(const QString &text);
     RichTextDocument(const RichTextDocument &rhs);
@@ -39,7 +41,11 @@ public:
     auto setAlignment(Qt::Alignment alignment) -> void;
     auto setWrapMode(QTextOption::WrapMode wrapMode) -> void;
     auto setFormat(QTextFormat::Property property, const QVariant &data) -> void;
-    auto draw(QPainter *painter, const QPointF &pos) -> void;
+    auto draw(QPainter *painter, const QPointF &pos) const -> void;
+    // strokes contours of glyphs, which is faster than drawing whole
+    // document again with outline format
+    auto drawOutline(QPainter *painter, const QPointF &pos,
+                     const QPen &pen) const -> void;
     auto drawBoudingBoxes(QPainter *painter, const QPointF &pos) -> void;
     auto doLayout(double maxWidth) -> void;
     auto updateLayoutInfo() -> void;
@@ -51,6 +57,8 @@ public:
     auto setLeading(double newLine, double paragraph) -> void;
     auto clear() -> void { freeLayouts(); m_blocks.clear(); setChanged(true); }
     const QVector<QRectF> &boundingBoxes() const { return m_boxes; }
+    // shaped glyphs of laid out document with their foreground colors
+    auto glyphRuns() const -> QVector<GlyphRun>;
 private:
     struct Layout {
         QTextLayout block;
@@ -69,6 +77,7 @@ private:
     QVector<Layout*> m_layouts;
     bool m_blockChanged, m_formatChanged, m_optionChanged, m_pxChanged, m_dirty;
     QRectF m_natural;
+    mutable QPainterPath m_outline;
 };
 
 #endif // RICHTEXTDOCUMENT_HPP
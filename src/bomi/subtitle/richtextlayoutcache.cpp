@@ -0,0 +1,25 @@
+#include "richtextlayoutcache.hpp"
+
+auto qHash(const RichTextLayoutKey &key, uint seed) -> uint
+{
+    uint hash = qHash(key.style, seed) ^ qHash(key.width, seed);
+    for (auto &block : key.text)
+        hash = (hash << 5) + (hash >> 27) + qHash(block.text, seed);
+    return hash;
+}
+
+auto RichTextLayoutCache::get(const Key &key,
+                              const RichTextDocument &base) -> RichTextDocument&
+{
+    if (auto doc = m_cache.object(key)) {
+        ++m_hits;
+        return *doc;
+    }
+    ++m_misses;
+    auto doc = new RichTextDocument(base);
+    *doc += key.text;
+    doc->updateLayoutInfo();
+    doc->doLayout(key.width);
+    m_cache.insert(key, doc);
+    return *doc;
+}
@@ -0,0 +1,41 @@
+#ifndef RICHTEXTLAYOUTCACHE_HPP
+#define RICHTEXTLAYOUTCACHE_HPP
+
+#include "richtextdocument.hpp"
+#include <QCache>
+
+struct RichTextLayoutKey {
+    QList<RichTextBlock> text;
+    QString style; // formats of base document which affect layout
+    double width = 0.0;
+    DECL_EQ(RichTextLayoutKey, &T::text, &T::style, &T::width)
+};
+
+auto qHash(const RichTextLayoutKey &key, uint seed = 0) -> uint;
+
+// shaped and laid out documents which can be reused for any scale
+// copied cache starts empty, so owner can be copied around threads freely
+class RichTextLayoutCache {
+public:
+    using Key = RichTextLayoutKey;
+    RichTextLayoutCache(int size = 32): m_cache(size) { }
+    RichTextLayoutCache(const RichTextLayoutCache &rhs)
+        : m_cache(rhs.m_cache.maxCost()) { }
+    auto operator = (const RichTextLayoutCache &rhs) -> RichTextLayoutCache&
+    {
+        m_cache.clear();
+        m_cache.setMaxCost(rhs.m_cache.maxCost());
+        m_hits = m_misses = 0;
+        return *this;
+    }
+    // returned document is valid until next call
+    auto get(const Key &key, const RichTextDocument &base) -> RichTextDocument&;
+    auto clear() -> void { m_cache.clear(); }
+    auto hits() const -> quint64 { return m_hits; }
+    auto misses() const -> quint64 { return m_misses; }
+private:
+    QCache<Key, RichTextDocument> m_cache;
+    quint64 m_hits = 0, m_misses = 0;
+};
+
+#endif // RICHTEXTLAYOUTCACHE_HPP
@@ -0,0 +1,285 @@
+#include "shadoweffect.hpp"
+#include "misc/log.hpp"
+#include "misc/parallel.hpp"
+#include <QElapsedTimer>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+DECLARE_LOG_CONTEXT(Subtitle)
+
+// run func(from, to) over [0, count) splitting it into global thread pool
+// when amount of pixels to process is large enough
+template<class F>
+static auto parallelize(int count, int pixels, const F &func) -> void
+{
+    static constexpr int PixelsPerJob = 256 * 1024;
+    if (count < 1)
+        return;
+    const int jobs = qMin(_ParallelJobs(pixels, PixelsPerJob), count);
+    const int chunk = (count + jobs - 1) / jobs;
+    _ParallelFor((count + chunk - 1) / chunk, [&] (int job) {
+        const int from = job * chunk;
+        func(from, qMin(from + chunk, count));
+    });
+}
+
+SIA div255(int x) -> int { x += 128; return (x + (x >> 8)) >> 8; }
+
+#ifdef __SSE2__
+SIA div255(__m128i x) -> __m128i
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+#endif
+
+// dst[i] = alpha(src[i]) * mul / 256
+SIA extractAlpha(uchar *dst, const quint32 *src, int n, int mul) -> void
+{
+    int i = 0;
+#ifdef __SSE2__
+    const auto m = _mm_set1_epi16(mul);
+    for (; i + 16 <= n; i += 16) {
+        auto p = reinterpret_cast<const __m128i*>(src + i);
+        const auto a0 = _mm_srli_epi32(_mm_loadu_si128(p + 0), 24);
+        const auto a1 = _mm_srli_epi32(_mm_loadu_si128(p + 1), 24);
+        const auto a2 = _mm_srli_epi32(_mm_loadu_si128(p + 2), 24);
+        const auto a3 = _mm_srli_epi32(_mm_loadu_si128(p + 3), 24);
+        auto lo = _mm_packs_epi32(a0, a1), hi = _mm_packs_epi32(a2, a3);
+        lo = _mm_srli_epi16(_mm_mullo_epi16(lo, m), 8);
+        hi = _mm_srli_epi16(_mm_mullo_epi16(hi, m), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = (src[i] >> 24) * mul >> 8;
+}
+
+// horizontal box filter of radius r, mul = 65536/(2r + 1)
+SIA boxRow(uchar *dst, const uchar *src, int n, int r, int mul) -> void
+{
+    int sum = 0;
+    for (int x = 0; x < qMin(r, n); ++x)
+        sum += src[x];
+    for (int x = 0; x < n; ++x) {
+        if (x + r < n)
+            sum += src[x + r];
+        dst[x] = (sum * mul) >> 16;
+        if (x >= r)
+            sum -= src[x - r];
+    }
+}
+
+SIA addRow(quint16 *sums, const uchar *src, int n) -> void
+{
+    int i = 0;
+#ifdef __SSE2__
+    const auto zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        auto s = reinterpret_cast<__m128i*>(sums + i);
+        const auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(s, _mm_add_epi16(_mm_loadu_si128(s),
+                                          _mm_unpacklo_epi8(v, zero)));
+    }
+#endif
+    for (; i < n; ++i)
+        sums[i] += src[i];
+}
+
+SIA subRow(quint16 *sums, const uchar *src, int n) -> void
+{
+    int i = 0;
+#ifdef __SSE2__
+    const auto zero = _mm_setzero_si128();
+    for (; i + 8 <= n; i += 8) {
+        auto s = reinterpret_cast<__m128i*>(sums + i);
+        const auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(s, _mm_sub_epi16(_mm_loadu_si128(s),
+                                          _mm_unpacklo_epi8(v, zero)));
+    }
+#endif
+    for (; i < n; ++i)
+        sums[i] -= src[i];
+}
+
+SIA storeRow(uchar *dst, const quint16 *sums, int n, int mul) -> void
+{
+    int i = 0;
+#ifdef __SSE2__
+    const auto m = _mm_set1_epi16(mul);
+    for (; i + 8 <= n; i += 8) {
+        auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + i));
+        s = _mm_mulhi_epu16(s, m);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packus_epi16(s, s));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = (sums[i] * mul) >> 16;
+}
+
+// vertical box filter for columns [x0, x1) with running sums of rows
+SIA boxColumns(uchar *dst, const uchar *src, int w, int h,
+               int x0, int x1, int r, int mul) -> void
+{
+    const int n = x1 - x0;
+    QVector<quint16> buffer(n, 0);
+    auto sums = buffer.data();
+    src += x0; dst += x0;
+    for (int y = 0; y < qMin(r, h); ++y)
+        addRow(sums, src + y * w, n);
+    for (int y = 0; y < h; ++y) {
+        if (y + r < h)
+            addRow(sums, src + (y + r) * w, n);
+        storeRow(dst + y * w, sums, n, mul);
+        if (y >= r)
+            subRow(sums, src + (y - r) * w, n);
+    }
+}
+
+// dst = dst + shadow * (1 - alpha(dst)), shadow = (b, g, r, 255) * alpha
+SIA compositeRow(quint32 *dst, const uchar *alpha, int n,
+                 int r, int g, int b) -> void
+{
+    int i = 0;
+#ifdef __SSE2__
+    const auto zero = _mm_setzero_si128();
+    const auto k255 = _mm_set1_epi16(255);
+    const auto color = _mm_setr_epi16(b, g, r, 255, b, g, r, 255);
+    auto blend = [&] (__m128i t, __m128i a) {
+        const auto ta = _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, 0xff), 0xff);
+        const auto m = div255(_mm_mullo_epi16(a, _mm_sub_epi16(k255, ta)));
+        return _mm_adds_epu16(t, div255(_mm_mullo_epi16(m, color)));
+    };
+    for (; i + 4 <= n; i += 4) {
+        auto p = reinterpret_cast<__m128i*>(dst + i);
+        const auto px = _mm_loadu_si128(p);
+        quint32 a4; memcpy(&a4, alpha + i, 4);
+        auto a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(a4), zero);
+        a = _mm_unpacklo_epi16(a, a);
+        const auto lo = blend(_mm_unpacklo_epi8(px, zero), _mm_unpacklo_epi32(a, a));
+        const auto hi = blend(_mm_unpackhi_epi8(px, zero), _mm_unpackhi_epi32(a, a));
+        _mm_storeu_si128(p, _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < n; ++i) {
+        const quint32 p = dst[i];
+        const int m = div255(alpha[i] * (255 - (p >> 24)));
+        if (!m)
+            continue;
+        auto add = [&] (int shift, int c) -> quint32 {
+            const int v = ((p >> shift) & 0xff) + div255(m * c);
+            return quint32(qMin(v, 255)) << shift;
+        };
+        dst[i] = add(0, b) | add(8, g) | add(16, r) | add(24, 255);
+    }
+}
+
+auto ShadowEffect::shift(const QImage &image, const QPoint &offset,
+                         int alpha) -> void
+{
+    const int w = image.width(), h = image.height();
+    const int ox = qBound(0, offset.x(), w), oy = qBound(0, offset.y(), h);
+    auto dst = m_alpha.data();
+    auto src = image.constBits();
+    const int bpl = image.bytesPerLine();
+    memset(dst, 0, w * oy);
+    parallelize(h - oy, (h - oy) * w, [&] (int from, int to) {
+        for (int y = from; y < to; ++y) {
+            auto line = dst + (y + oy) * w;
+            memset(line, 0, ox);
+            extractAlpha(line + ox, reinterpret_cast<const quint32*>(src + bpl * y),
+                         w - ox, alpha);
+        }
+    });
+}
+
+auto ShadowEffect::blur(int w, int h, int radius) -> void
+{
+    Q_ASSERT(0 < radius && radius < 128);
+    const int mul = (1 << 16)/(2 * radius + 1);
+    auto a = m_alpha.data(), t = m_temp.data();
+    parallelize(h, w * h, [&] (int from, int to) {
+        for (int y = from; y < to; ++y)
+            boxRow(t + y * w, a + y * w, w, radius, mul);
+    });
+    static constexpr int Columns = 64;
+    parallelize((w + Columns - 1)/Columns, w * h, [&] (int from, int to) {
+        boxColumns(a, t, w, h, from * Columns, qMin(to * Columns, w),
+                   radius, mul);
+    });
+}
+
+auto ShadowEffect::composite(QImage &image, const QColor &color) const -> void
+{
+    const int w = image.width(), h = image.height();
+    const int r = color.red(), g = color.green(), b = color.blue();
+    auto bits = image.bits();
+    const int bpl = image.bytesPerLine();
+    auto alpha = m_alpha.constData();
+    parallelize(h, w * h, [&] (int from, int to) {
+        for (int y = from; y < to; ++y)
+            compositeRow(reinterpret_cast<quint32*>(bits + bpl * y),
+                         alpha + y * w, w, r, g, b);
+    });
+}
+
+auto ShadowEffect::apply(QImage &image, const QPoint &offset,
+                         const QColor &color, int blur) -> void
+{
+    if (image.isNull() || !color.alpha())
+        return;
+    Q_ASSERT(image.format() == QImage::Format_ARGB32_Premultiplied);
+    const int w = image.width(), h = image.height();
+    m_alpha.resize(w * h);
+    shift(image, offset, color.alpha());
+    if (blur > 0) {
+        m_temp.resize(w * h);
+        // sums of box are kept in 16 bits
+        blur = qMin(blur, 127);
+        // approximate gaussian with three boxes of same variance if possible
+        const int r3 = qRound(std::sqrt(blur * (blur + 1) / 3.0 + 0.25) - 0.5);
+        if (r3 > 0) {
+            for (int i = 0; i < 3; ++i)
+                this->blur(w, h, r3);
+        } else
+            this->blur(w, h, blur);
+    }
+    composite(image, color);
+}
+
+auto ShadowEffect::benchmark() -> void
+{
+    // two lines of caption for 720p, 1080p and 2160p
+    const QList<QSize> sizes = { {800, 100}, {1200, 150}, {2400, 300} };
+    const QList<int> radii = { 1, 2, 4, 8 };
+    static constexpr int loop = 100;
+    ShadowEffect effect;
+    for (auto &size : sizes) {
+        QImage source(size, QImage::Format_ARGB32_Premultiplied);
+        source.fill(0x0);
+        QPainter painter(&source);
+        auto font = painter.font();
+        font.setPixelSize(size.height() * 0.4);
+        painter.setFont(font);
+        painter.setPen(Qt::white);
+        painter.drawText(source.rect(), Qt::AlignCenter | Qt::TextWordWrap,
+                         u"The quick brown fox jumps over the lazy dog.\n"
+                         "0123456789 ABCDEFGHIJKLMNOPQRSTUVWXYZ"_q);
+        painter.end();
+        for (auto radius : radii) {
+            qint64 ns = 0;
+            QElapsedTimer timer;
+            for (int i = 0; i < loop; ++i) {
+                auto image = source.copy();
+                timer.start();
+                effect.apply(image, { 4, 4 }, QColor(0, 0, 0, 127), radius);
+                ns += timer.nsecsElapsed();
+            }
+            _Info("shadow %% with blur %%: %%us", size, radius,
+                  ns / loop / 1000.0);
+        }
+    }
+}
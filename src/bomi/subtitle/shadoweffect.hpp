@@ -0,0 +1,19 @@
+#ifndef SHADOWEFFECT_HPP
+#define SHADOWEFFECT_HPP
+
+// drop shadow for premultiplied ARGB image which is drawn in place
+class ShadowEffect {
+public:
+    // offset should be non-negative and image should have enough padding for
+    // offset and blur radius
+    auto apply(QImage &image, const QPoint &offset,
+               const QColor &color, int blur) -> void;
+    static auto benchmark() -> void;
+private:
+    auto shift(const QImage &image, const QPoint &offset, int alpha) -> void;
+    auto blur(int w, int h, int radius) -> void;
+    auto composite(QImage &image, const QColor &color) const -> void;
+    QVector<uchar> m_alpha, m_temp;
+};
+
+#endif // SHADOWEFFECT_HPP
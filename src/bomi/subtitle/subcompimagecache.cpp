@@ -0,0 +1,79 @@
+#include "subcompimagecache.hpp"
+
+SubCompImageCache::SubCompImageCache(qint64 budget)
+{
+    setBudget(budget);
+}
+
+auto SubCompImageCache::find(const Key &key, SubCompImage *image) -> bool
+{
+    QMutexLocker locker(&m_mutex);
+    auto cached = m_cache.object(key);
+    if (!cached) {
+        ++m_misses;
+        return false;
+    }
+    ++m_hits;
+    *image = *cached;
+    return true;
+}
+
+auto SubCompImageCache::contains(const Key &key) const -> bool
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.contains(key);
+}
+
+auto SubCompImageCache::insert(const Key &key, const SubCompImage &image,
+                               bool prefetch) -> void
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_cache.insert(key, new SubCompImage(image), cost(image)) && prefetch)
+        ++m_prefetched;
+}
+
+auto SubCompImageCache::remove(const SubComp *comp) -> void
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto &key : m_cache.keys()) {
+        if (key.comp == comp)
+            m_cache.remove(key);
+    }
+}
+
+auto SubCompImageCache::clear() -> void
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+}
+
+auto SubCompImageCache::budget() const -> qint64
+{
+    QMutexLocker locker(&m_mutex);
+    return qint64(m_cache.maxCost()) << 10;
+}
+
+auto SubCompImageCache::setBudget(qint64 bytes) -> void
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(qBound<qint64>(0, bytes >> 10, _Max<int>()));
+}
+
+auto SubCompImageCache::stats() const -> Stats
+{
+    QMutexLocker locker(&m_mutex);
+    Stats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.prefetched = m_prefetched;
+    stats.bytes = qint64(m_cache.totalCost()) << 10;
+    stats.budget = qint64(m_cache.maxCost()) << 10;
+    stats.count = m_cache.count();
+    return stats;
+}
+
+auto SubCompImageCache::resetStats() -> void
+{
+    QMutexLocker locker(&m_mutex);
+    m_hits = m_misses = m_prefetched = 0;
+}
@@ -0,0 +1,53 @@
+#ifndef SUBCOMPIMAGECACHE_HPP
+#define SUBCOMPIMAGECACHE_HPP
+
+#include "subtitledrawer.hpp"
+#include <QCache>
+
+struct SubCompImageCacheKey {
+    const SubComp *comp = nullptr;
+    int caption = 0; // start key of caption in SubComp
+    quint64 option = 0; // SubtitleDrawer::cacheKey()
+    DECL_EQ(SubCompImageCacheKey, &T::comp, &T::caption, &T::option)
+};
+
+SIA qHash(const SubCompImageCacheKey &key, uint seed = 0) -> uint
+{
+    return qHash(key.comp, seed) ^ qHash(key.caption, seed)
+           ^ qHash(key.option, seed);
+}
+
+struct SubCompImageCacheStats {
+    quint64 hits = 0, misses = 0, prefetched = 0;
+    qint64 bytes = 0, budget = 0;
+    int count = 0;
+    auto hitRatio() const -> double
+        { return hits + misses ? hits/double(hits + misses) : 0.0; }
+};
+
+// thread-safe LRU cache of rendered captions with memory budget in bytes
+class SubCompImageCache {
+public:
+    using Key = SubCompImageCacheKey;
+    using Stats = SubCompImageCacheStats;
+    SubCompImageCache(qint64 budget = 64*1024*1024);
+    auto find(const Key &key, SubCompImage *image) -> bool;
+    auto contains(const Key &key) const -> bool;
+    auto insert(const Key &key, const SubCompImage &image,
+                bool prefetch = false) -> void;
+    auto remove(const SubComp *comp) -> void;
+    auto clear() -> void;
+    auto budget() const -> qint64;
+    auto setBudget(qint64 bytes) -> void;
+    auto stats() const -> Stats;
+    auto resetStats() -> void;
+private:
+    // QCache counts cost in int, so use KiB as unit
+    static auto cost(const SubCompImage &image) -> int
+        { return (image.byteCount() >> 10) + 1; }
+    mutable QMutex m_mutex;
+    QCache<Key, SubCompImage> m_cache;
+    quint64 m_hits = 0, m_misses = 0, m_prefetched = 0;
+};
+
+#endif // SUBCOMPIMAGECACHE_HPP
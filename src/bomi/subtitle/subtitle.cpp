@@ -10,18 +10,8 @@ auto SubComp::name() const -> QString
     return m_klass.isEmpty() ? m_file : m_file % "("_a % m_klass % ")"_a;
 }
 
-auto Subtitle::component(double frameRate) const -> SubComp
-{
-    if (m_comp.isEmpty())
-        return SubComp();
-    SubComp comp;
-    for (int i=0; i<m_comp.size(); ++i)
-        comp.unite(m_comp[i], frameRate);
-    return comp;
-}
-
 SubComp::SubComp() {
-    m_capts[0].index = 0;
+    (*this)[0].index = 0;
 }
 
 SubComp::SubComp(SubType type, const QFileInfo &file, const EncodingInfo &enc, int id, SyncType b)
@@ -32,7 +22,7 @@ SubComp::SubComp(SubType type, const QFileInfo &file, const EncodingInfo &enc, i
     , m_id(id)
 {
     m_type = type;
-    m_capts[0].index = 0;
+    (*this)[0].index = 0;
 }
 
 auto SubComp::toTrack() const -> StreamTrack
@@ -40,82 +30,71 @@ auto SubComp::toTrack() const -> StreamTrack
     return StreamTrack::fromSubComp(*this);
 }
 
-auto SubComp::united(const SubComp &other, double frameRate) const -> SubComp
+auto SubComp::indexOf(int key) const -> int
 {
-    return SubComp(*this).unite(other, frameRate);
+    const auto it = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+    return it != m_keys.end() && *it == key ? it - m_keys.begin() : -1;
 }
 
-auto SubComp::start(int time, double frameRate) const -> const_iterator
+auto SubComp::operator[] (int key) -> SubCapt&
 {
-    if (isEmpty() || time < 0)
-        return end();
-    return --finish(time, frameRate);
+    // parsers append captions in order mostly
+    if (m_keys.isEmpty() || m_keys.last() < key) {
+        m_keys.push_back(key);
+        m_capts.push_back(SubCapt());
+        return m_capts.last();
+    }
+    const auto it = std::lower_bound(m_keys.begin(), m_keys.end(), key);
+    const int i = it - m_keys.begin();
+    if (*it != key) {
+        m_keys.insert(i, key);
+        m_capts.insert(i, SubCapt());
+    }
+    return m_capts[i];
 }
 
-auto SubComp::finish(int time, double frameRate) const -> const_iterator
+auto SubComp::operator[] (int key) const -> SubCapt
 {
-    if (isEmpty() || time < 0)
-        return end();
-    int key = time;
-    if (m_base == Frame) {
-        if (frameRate < 0.0)
-            return end();
-        key = qRound(time*0.001*frameRate);
-    }
-    return upperBound(key);
+    const int i = indexOf(key);
+    return i < 0 ? SubCapt() : m_capts[i];
 }
 
-auto SubComp::unite(const SubComp &rhs, double fps) -> SubComp&
+auto SubComp::insert(int key, const SubCapt &capt) -> It
 {
-    if (this == &rhs || rhs.isEmpty())
-        return *this;
-    else if (isEmpty())
-        return *this = rhs;
-    auto convertKeyBase = [this] (int key, SyncType from, SyncType to,
-                                  double frameRate) {
-        return  (from == to) ? key : ((to == Time) ? msec(key, frameRate)
-                                                   : frame(key, frameRate));
-    };
-
-    auto it1 = m_capts.begin();
-    auto it2 = rhs.begin();
-    const auto k2 = convertKeyBase(it2.key(), rhs.base(), m_base, fps);
-    if (it2.key() < it1.key()) {
-        while (k2 < it1.key()) {
-            m_capts.insert(k2, *it2);
-            ++it2;
-        }
-    } else if (k2 == it1.key()){
-        *it1 += *it2;
-        ++it2;
-    } else
-        it1 = --m_capts.lowerBound(k2);
-
-    while (it2 != rhs.end()) {
-        auto &cap1 = *it1;
-//        const int ka = it1.key();
-        const int kb = ++it1 != m_capts.end() ? it1.key() : -1;
-//        Q_ASSERT(ka < k2);
-        int k2 = 0;
-        while (it2 != rhs.end()) {
-            k2 = convertKeyBase(it2.key(), rhs.base(), m_base, fps);
-            if (!(kb == -1 || k2 < kb))
-                break;
-            *m_capts.insert(k2, cap1) += *it2;
-            ++it2;
-        }
-        if (it2 == rhs.end())
-            break;
-        if (k2 == kb)
-            *it1 += *it2++;
-        else if (it2 != rhs.begin())
-            *it1 += *(it2-1);
-    }
+    auto &c = (*this)[key];
+    c = capt;
+    return {this, int(&c - m_capts.data())};
+}
 
-    auto it = m_capts.begin();
-    for (int idx = 0; it != m_capts.end(); ++idx, ++it)
-        it->index = idx;
-    return *this;
+// index of first caption which starts after time or -1 if not available
+auto SubComp::upper(int time, double fps) const -> int
+{
+    if (isEmpty() || time < 0 || (m_base == Frame && fps <= 0.0))
+        return -1;
+    // compare in msec with the same conversion as start of caption
+    // not to show frame-based caption before its start
+    if (m_base == Frame)
+        return std::upper_bound(m_keys.begin(), m_keys.end(), time,
+            [&] (int t, int key) { return t < msec(key, fps); }) - m_keys.begin();
+    return std::upper_bound(m_keys.begin(), m_keys.end(), time) - m_keys.begin();
+}
+
+auto SubComp::find(int time, double fps) const -> int
+{
+    const int i = upper(time, fps);
+    return i < 0 ? -1 : i - 1;
+}
+
+auto SubComp::start(int time, double frameRate) const -> const_iterator
+{
+    const int i = find(time, frameRate);
+    return i < 0 ? end() : const_iterator(this, i);
+}
+
+auto SubComp::finish(int time, double frameRate) const -> const_iterator
+{
+    const int i = upper(time, frameRate);
+    return i < 0 ? end() : const_iterator(this, i);
 }
 
 auto Subtitle::caption(int time, double fps) const -> RichTextDocument
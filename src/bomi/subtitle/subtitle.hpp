@@ -27,38 +27,73 @@ struct SubCapt : public RichTextDocument {
     mutable int index;
 };
 
+// position of caption which stays valid until SubComp is modified
+template<class Comp, class Capt>
+class SubCompIterator {
+public:
+    SubCompIterator() = default;
+    SubCompIterator(Comp *comp, int index): m_comp(comp), m_index(index) { }
+    template<class C, class T>
+    SubCompIterator(const SubCompIterator<C, T> &rhs)
+        : m_comp(rhs.m_comp), m_index(rhs.m_index) { }
+    auto operator == (const SubCompIterator &rhs) const -> bool
+        { return m_comp == rhs.m_comp && m_index == rhs.m_index; }
+    auto operator != (const SubCompIterator &rhs) const -> bool
+        { return !operator == (rhs); }
+    auto operator ++ () -> SubCompIterator& { ++m_index; return *this; }
+    auto operator -- () -> SubCompIterator& { --m_index; return *this; }
+    auto operator ++ (int) -> SubCompIterator { return {m_comp, m_index++}; }
+    auto operator -- (int) -> SubCompIterator { return {m_comp, m_index--}; }
+    auto operator + (int n) const -> SubCompIterator { return {m_comp, m_index + n}; }
+    auto operator - (int n) const -> SubCompIterator { return {m_comp, m_index - n}; }
+    auto operator * () const -> Capt& { return value(); }
+    auto operator -> () const -> Capt* { return &value(); }
+    auto key() const -> int { return m_comp->key(m_index); }
+    auto value() const -> Capt& { return m_comp->caption(m_index); }
+    auto index() const -> int { return m_index; }
+private:
+    template<class C, class T> friend class SubCompIterator;
+    Comp *m_comp = nullptr;
+    int m_index = 0;
+};
+
+// captions are stored in sorted start keys and separate payloads, and each
+// caption lasts until start of next one
+// keys are in base unit and converted to msec only on lookup, so fps and
+// delay are applied lazily without copying
 class SubComp {
 public:
-    using Map = QMap<int, SubCapt>;
-    using It = Map::iterator;
-    using ConstIt = Map::const_iterator;
-    using iterator = Map::iterator;
-    using const_iterator = Map::const_iterator;
+    using It = SubCompIterator<SubComp, SubCapt>;
+    using ConstIt = SubCompIterator<const SubComp, const SubCapt>;
+    using iterator = It;
+    using const_iterator = ConstIt;
     enum SyncType { Time, Frame };
     SubComp();
     auto operator == (const SubComp &rhs) const -> bool
         {return m_path == rhs.m_path && m_klass == rhs.m_klass;}
     auto operator != (const SubComp &rhs) const -> bool {return !operator==(rhs);}
-    auto operator[] (int key) -> SubCapt& { return m_capts[key]; }
-    auto operator[] (int key) const -> SubCapt { return m_capts[key]; }
-    auto unite(const SubComp &other, double frameRate) -> SubComp&;
-    auto united(const SubComp &other, double frameRate) const -> SubComp;
+    auto operator[] (int key) -> SubCapt&;
+    auto operator[] (int key) const -> SubCapt;
 
     auto hasWords() const -> bool
         { for (auto &c : m_capts) if (c.hasWords()) return true; return false; }
-    auto isEmpty() const -> bool { return m_capts.isEmpty(); }
-    auto begin() -> It { return m_capts.begin(); }
-    auto end() -> It { return m_capts.end(); }
-    auto begin() const -> ConstIt { return m_capts.begin(); }
-    auto end() const -> ConstIt { return m_capts.end(); }
-    auto cbegin() const -> ConstIt { return m_capts.cbegin(); }
-    auto cend() const -> ConstIt { return m_capts.cend(); }
-    auto upperBound(int key) -> It { return m_capts.upperBound(key); }
-    auto lowerBound(int key) -> It { return m_capts.lowerBound(key); }
-    auto upperBound(int key) const -> ConstIt { return m_capts.upperBound(key); }
-    auto lowerBound(int key) const -> ConstIt { return m_capts.lowerBound(key); }
-    auto insert(int key, const SubCapt &capt) -> It { return m_capts.insert(key, capt); }
-    auto contains(int key) const -> bool { return m_capts.contains(key); }
+    auto isEmpty() const -> bool { return m_keys.isEmpty(); }
+    auto size() const -> int { return m_keys.size(); }
+    auto key(int i) const -> int { return m_keys[i]; }
+    auto caption(int i) const -> const SubCapt& { return m_capts[i]; }
+    auto caption(int i) -> SubCapt& { return m_capts[i]; }
+    auto begin() -> It { return {this, 0}; }
+    auto end() -> It { return {this, size()}; }
+    auto begin() const -> ConstIt { return {this, 0}; }
+    auto end() const -> ConstIt { return {this, size()}; }
+    auto cbegin() const -> ConstIt { return begin(); }
+    auto cend() const -> ConstIt { return end(); }
+    auto upperBound(int key) const -> ConstIt
+        { return {this, int(std::upper_bound(m_keys.begin(), m_keys.end(), key) - m_keys.begin())}; }
+    auto lowerBound(int key) const -> ConstIt
+        { return {this, int(std::lower_bound(m_keys.begin(), m_keys.end(), key) - m_keys.begin())}; }
+    auto insert(int key, const SubCapt &capt) -> It;
+    auto contains(int key) const -> bool { return indexOf(key) >= 0; }
     auto name() const -> QString;
     auto fileName() const -> const QString& {return m_file;}
     auto path() const -> const QString& { return m_path; }
@@ -66,10 +101,12 @@ public:
     auto isBasedOnFrame() const -> bool {return m_base == Frame;}
 //    const Language &language() const {return m_lang;}
     auto language() const -> QString {return m_klass;}
+    // caption shown at time in msec and the next one
     auto start(int time, double frameRate) const -> const_iterator;
     auto finish(int time, double frameRate) const -> const_iterator;
+    // index of caption shown at time in msec or -1
+    auto find(int time, double frameRate) const -> int;
     auto toTime(int key, double fps) const -> int { return m_base == Time ? key : msec(key, fps); }
-    auto map() const -> const Map& { return m_capts; }
     auto setLanguage(const QString &lang) -> void { m_klass = lang; }
     auto selection() const -> bool { return m_selection; }
     auto selection() -> bool& { return m_selection; }
@@ -82,17 +119,18 @@ public:
 private:
     SubComp(SubType type, const QFileInfo &file, const EncodingInfo &enc, int id, SyncType base);
     friend class SubtitleParser;
+    auto indexOf(int key) const -> int;
+    auto upper(int time, double fps) const -> int;
     QString m_file, m_klass, m_path;
     EncodingInfo m_enc;
     SyncType m_base = Time;
-    Map m_capts;
+    QVector<int> m_keys;
+    QVector<SubCapt> m_capts;
     bool m_selection = false;
     int m_id = -1;
     SubType m_type = SubType::Unknown;
 };
 
-using SubtitleComponentIterator = QMapIterator<int, SubCapt>;
-
 class Subtitle {
 public:
     const SubComp &operator[] (int rhs) const {return m_comp[rhs];}
@@ -100,10 +138,10 @@ public:
     auto count() const -> int {return m_comp.size();}
     auto size() const -> int {return m_comp.size();}
     auto isEmpty() const -> bool;
-    auto component(double frameRate) const -> SubComp;
     const QList<SubComp> &components() const { return m_comp; }
 //    auto start(int time, double frameRate) const -> int;
 //    auto end(int time, double frameRate) const -> int;
+    // captions of all components are merged on lookup
     auto caption(int time, double frameRate) const -> RichTextDocument;
     auto load(const QString &file, const EncodingInfo &enc) -> bool;
     auto clear() -> void {m_comp.clear();}
@@ -46,12 +46,44 @@ auto SubtitleDrawer::setStyle(const OsdStyle &style) -> void
 {
     m_style = style;
     updateStyle(m_front, style);
-    updateStyle(m_back, style);
-    if (style.outline.enabled) {
-        const auto size = style.font.height()*style.outline.width*2.0;
-        m_back.setTextOutline(style.outline.color, size);
-    } else
-        m_back.setTextOutline(Qt::NoPen);
+    updateStyleKey();
+}
+
+auto SubtitleDrawer::updateStyleKey() -> void
+{
+    auto data = _JsonToString(m_style.toJson()).toUtf8();
+    data += QByteArray::number((int)m_alignment);
+    data += QByteArray::number((int)m_rasterize);
+    m_styleKey = (quint64(qHash(data, 0)) << 32) | qHash(data, 0x9e3779b9);
+    // outline, shadow and box are drawn over same layout
+    const auto &font = m_style.font;
+    m_layoutStyle = font.qfont.toString() % '/'_q % _N(font.color.rgba())
+            % '/'_q % _N((int)m_style.wrapMode) % '/'_q % _N((int)m_alignment)
+            % '/'_q % _N(m_style.spacing.line, 3)
+            % '/'_q % _N(m_style.spacing.paragraph, 3);
+}
+
+auto SubtitleDrawer::setRasterizing(bool on) -> void
+{
+    if (_Change(m_rasterize, on))
+        updateStyleKey();
+}
+
+auto SubtitleDrawer::layout(const RichTextDocument &text,
+                            const QRectF &area) const -> const RichTextDocument&
+{
+    // document is laid out in font pixels, so only aspect ratio matters
+    const double width = area.width()/scale(area);
+    return m_layouts.get({text.blocks(), m_layoutStyle, width}, m_front);
+}
+
+auto SubtitleDrawer::cacheKey(const QRectF &area, double dpr) const -> quint64
+{
+    // only size of area affects drawn image
+    const auto seed = qHash(m_styleKey);
+    const auto hash = qHash(area.width(), seed) ^ qHash(area.height(), ~seed)
+                      ^ qHash(dpr, seed >> 1);
+    return m_styleKey ^ (quint64(hash) << 16);
 }
 
 auto SubtitleDrawer::draw(QImage &image, int &gap, const RichTextDocument &text,
@@ -59,19 +91,11 @@ auto SubtitleDrawer::draw(QImage &image, int &gap, const RichTextDocument &text,
 {
     QVector<QRectF> bboxes;
     gap = 0;
-    if (!(m_drawn = text.hasWords()))
+    if (!(m_drawn = text.hasWords()) || !m_rasterize)
         return bboxes;
     const double scale = this->scale(area)*dpr;
     const double fscale = m_style.font.height()*scale;
-    auto make = [=] (RichTextDocument &doc, const RichTextDocument &from) {
-        doc = from;
-        doc += text;
-        doc.updateLayoutInfo();
-        doc.doLayout(area.width()/(scale/dpr));
-    };
-    RichTextDocument front, back;
-    make(front, m_front);
-    make(back, m_back);
+    const auto &front = layout(text, area);
     QPoint thick(0, 0);
     if (m_style.bbox.enabled)
         thick = (fscale*m_style.bbox.padding).toPoint();
@@ -104,48 +128,15 @@ auto SubtitleDrawer::draw(QImage &image, int &gap, const RichTextDocument &text,
         QPainter painter(&image);
         painter.translate(origin/dpr);
         painter.scale(scale/dpr, scale/dpr);
-        back.draw(&painter, QPointF(0, 0));
+        if (m_style.outline.enabled) {
+            const auto width = m_style.font.height()*m_style.outline.width*2.0;
+            front.drawOutline(&painter, QPointF(0, 0),
+                              QPen(m_style.outline.color, width));
+        }
         front.draw(&painter, QPointF(0, 0));
         painter.end();
-        if (m_style.shadow.enabled) {
-            QImage bg(image.size(), QImage::Format_ARGB32_Premultiplied);
-            bg.setDevicePixelRatio(dpr);
-            auto dest = bg.bits();
-            const quint32 sr = m_style.shadow.color.red();
-            const quint32 sg = m_style.shadow.color.green();
-            const quint32 sb = m_style.shadow.color.blue();
-            const quint32 sa = m_style.shadow.color.alpha();
-            for (int y=0; y<bg.height(); ++y) {
-                const int ys = y - soffset.y();
-                if (ys < 0) {
-                    memset(dest, 0, bg.bytesPerLine());
-                    dest += bg.bytesPerLine();
-                } else {
-                    auto src = image.bits() + image.bytesPerLine() * ys;
-                    for (int x=0; x<bg.width(); ++x) {
-                        const int xs = x-soffset.x();
-                        if (xs < 0) {
-                            *dest++ = 0;
-                            *dest++ = 0;
-                            *dest++ = 0;
-                            *dest++ = 0;
-                        } else {
-                            *dest++ = sb*sa*src[3] >> 16;
-                            *dest++ = sg*sa*src[3] >> 16;
-                            *dest++ = sr*sa*src[3] >> 16;
-                            *dest++ = sa*   src[3] >> 8;
-                            src += 4;
-                        }
-                    }
-                }
-            }
-            if (blur)
-                m_blur.applyTo(bg, m_style.shadow.color, blur);
-            painter.begin(&bg);
-            painter.drawImage(QPoint(0, 0), image);
-            painter.end();
-            image.swap(bg);
-        }
+        if (m_style.shadow.enabled)
+            m_shadow.apply(image, soffset, m_style.shadow.color, blur);
         if (m_style.bbox.enabled) {
             bboxes = front.boundingBoxes();
             if (!bboxes.isEmpty()) {
@@ -3,6 +3,8 @@
 
 #include "misc/osdstyle.hpp"
 #include "subtitle.hpp"
+#include "shadoweffect.hpp"
+#include "richtextlayoutcache.hpp"
 
 struct Margin {
     Margin() {}
@@ -11,103 +13,6 @@ struct Margin {
     double top = 0.0, right = 0.0, bottom = 0.0, left = 0.0;
 };
 
-class FastAlphaBlur {
-public:
-    FastAlphaBlur(): radius(-1) {}
-    // copied from openframeworks superfast blur and modified
-    auto applyTo(QImage &mask, const QColor &color, int radius) -> void {
-        if (radius < 1 || mask.isNull())
-            return;
-        setSize(mask.size());
-        setRadius(radius);
-        const int w = s.width();
-        const int h = s.height();
-
-        uchar *a = valpha.data();
-        const uchar *inv = vinv.constData();
-        int *min = vmin.data();
-        int *max = vmax.data();
-
-        const int xmax = mask.width()-1;
-        for (int x=0; x<w; ++x) {
-            min[x] = qMin(x + radius + 1, xmax);
-            max[x] = qMax(x - radius, 0);
-        }
-
-        const uchar *c_bits = mask.constBits()+3;
-        uchar *it = a;
-        for (int y=0; y<h; ++y, c_bits += (mask.width() << 2)) {
-            int sum = 0;
-            for(int i=-radius; i<=radius; ++i)
-                sum += c_bits[qBound(0, i, xmax) << 2];
-            for (int x=0; x<w; ++x, ++it) {
-                sum += c_bits[min[x] << 2];
-                sum -= c_bits[max[x] << 2];
-                *it = inv[sum];
-            }
-        }
-
-        const int ymax = mask.height()-1;
-        for (int y=0; y<h; ++y){
-            min[y] = qMin(y + radius + 1, ymax)*w;
-            max[y] = qMax(y - radius, 0)*w;
-        }
-
-        uchar *bits = mask.bits();
-        const double r = color.redF();
-        const double g = color.greenF();
-        const double b = color.blueF();
-        const uchar *c_it = a;
-        for (int x=0; x<w; ++x, ++c_it){
-            int sum = 0;
-            int yp = -radius*w;
-            for(int i=-radius; i<=radius; ++i, yp += w)
-                sum += c_it[qMax(0, yp)];
-            uchar *p = bits + (x << 2);
-            for (int y=0; y<h; ++y, p += (xmax << 2)){
-                const uchar a = inv[sum];
-                if (p[3] < 255) {
-                    *p++ = a*b;
-                    *p++ = a*g;
-                    *p++ = a*r;
-                    *p++ = a;
-                } else {
-                    p += 4;
-                }
-                sum += c_it[min[y]];
-                sum -= c_it[max[y]];
-            }
-        }
-    }
-
-private:
-    auto setSize(const QSize &size) -> void {
-        if (size != s) {
-            s = size;
-            if (!s.isEmpty()) {
-                vmin.resize(qMax(s.width(), s.height()));
-                vmax.resize(vmin.size());
-                valpha.resize(s.width()*s.height());
-            }
-        }
-    }
-    auto setRadius(const int radius) -> void {
-        if (this->radius != radius) {
-            this->radius = radius;
-            if (radius > 0) {
-                const int range = (radius << 1) + 1;
-                vinv.resize(range << 8);
-                for (int i=0; i<vinv.size(); ++i)
-                    vinv[i] = i/range;
-            }
-        }
-    }
-    int radius;
-    QSize s;
-    QVector<int> vmin, vmax;
-    QVector<uchar> valpha, vinv;
-};
-
 class SubCompImage : public QImage {
     using Iterator = SubComp::const_iterator;
 public:
@@ -145,22 +50,35 @@ public:
     auto margin() const -> const Margin& { return m_margin; }
     auto style() const -> const OsdStyle& {return m_style;}
     auto scale(const QRectF &area) const -> double;
+    // laid out text to be drawn with scale(area)*dpr, valid until next call
+    auto layout(const RichTextDocument &text,
+                const QRectF &area) const -> const RichTextDocument&;
+    // when disabled, draw() only checks text and leaves image null
+    // for backends which rasterize glyphs by themselves
+    auto setRasterizing(bool on) -> void;
+    auto isRasterizing() const -> bool { return m_rasterize; }
+    // identifies images drawn by this drawer for given area and dpr
+    auto cacheKey(const QRectF &area, double dpr) const -> quint64;
 private:
+    auto updateStyleKey() -> void;
     static auto updateStyle(RichTextDocument &doc,
                             const OsdStyle &style) -> void;
     OsdStyle m_style;
-    RichTextDocument m_front, m_back;
+    RichTextDocument m_front;
+    QString m_layoutStyle;
+    mutable RichTextLayoutCache m_layouts;
     Margin m_margin;
     Qt::Alignment m_alignment;
-    bool m_drawn = false;
-    FastAlphaBlur m_blur;
+    bool m_drawn = false, m_rasterize = true;
+    quint64 m_styleKey = 0;
+    ShadowEffect m_shadow;
     QByteArray m_buffer;
 };
 
 inline auto SubtitleDrawer::setAlignment(Qt::Alignment alignment) -> void
 {
-    m_back.setAlignment(m_alignment = alignment);
-    m_front.setAlignment(alignment);
+    m_front.setAlignment(m_alignment = alignment);
+    updateStyleKey();
 }
 
 inline auto SubtitleDrawer::draw(SubCompImage &pic, const QRectF &area,
@@ -0,0 +1,143 @@
+#include "subtitleglyphatlas.hpp"
+#include "opengl/opengltexture2d.hpp"
+#include "opengl/opengltexturetransferinfo.hpp"
+
+static constexpr int Padding = 1;
+
+SubtitleGlyphAtlas::SubtitleGlyphAtlas(int size)
+    : m_size(size)
+{
+    clear();
+}
+
+auto SubtitleGlyphAtlas::clear() -> void
+{
+    m_data.fill(0, m_size * m_size);
+    m_shelves.clear();
+    m_fonts.clear();
+    m_glyphs.clear();
+    // reserve top-left corner for solid()
+    for (int y = 0; y < 4; ++y)
+        memset(m_data.data() + y * m_size, 255, 4);
+    m_shelves.push_back({0, 4 + Padding, 4 + Padding});
+    m_bottom = m_shelves.last().height;
+    m_dirtyTop = 0;
+    m_dirtyBottom = m_size;
+}
+
+auto SubtitleGlyphAtlas::fontId(const QRawFont &font) -> int
+{
+    const auto key = font.familyName() % '/'_q % font.styleName() % '/'_q
+                     % _N(font.weight()) % '/'_q % _N((int)font.style())
+                     % '/'_q % _N(font.pixelSize(), 2);
+    auto it = m_fonts.find(key);
+    if (it == m_fonts.end())
+        it = m_fonts.insert(key, m_fonts.size());
+    return *it;
+}
+
+auto SubtitleGlyphAtlas::allocate(const QSize &size) -> QPoint
+{
+    const int w = size.width() + Padding, h = size.height() + Padding;
+    Shelf *best = nullptr;
+    for (auto &shelf : m_shelves) {
+        // avoid wasting tall shelf for small glyph
+        if (shelf.height < h || shelf.height > h * 3 / 2 + 2
+                || shelf.x + w > m_size)
+            continue;
+        if (!best || shelf.height < best->height)
+            best = &shelf;
+    }
+    if (!best) {
+        if (m_bottom + h > m_size || w > m_size)
+            return {-1, -1};
+        m_shelves.push_back({m_bottom, h, 0});
+        m_bottom += h;
+        best = &m_shelves.last();
+    }
+    const QPoint pos(best->x, best->y);
+    best->x += w;
+    return pos;
+}
+
+auto SubtitleGlyphAtlas::rasterize(const QPainterPath &path, const QRect &bound,
+                                   const QPoint &pos) -> void
+{
+    if (m_scratch.width() < bound.width() || m_scratch.height() < bound.height())
+        m_scratch = QImage(bound.size().expandedTo(m_scratch.size()),
+                           QImage::Format_ARGB32_Premultiplied);
+    m_scratch.fill(0x0);
+    QPainter painter(&m_scratch);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.translate(-bound.topLeft());
+    painter.fillPath(path, Qt::white);
+    painter.end();
+    for (int y = 0; y < bound.height(); ++y) {
+        auto src = reinterpret_cast<const quint32*>(m_scratch.constScanLine(y));
+        auto dst = m_data.data() + (pos.y() + y) * m_size + pos.x();
+        for (int x = 0; x < bound.width(); ++x)
+            dst[x] = src[x] >> 24;
+    }
+    m_dirtyTop = qMin(m_dirtyTop, pos.y());
+    m_dirtyBottom = qMax(m_dirtyBottom, pos.y() + bound.height());
+}
+
+auto SubtitleGlyphAtlas::glyph(const QRawFont &font, quint32 index,
+                               double outline) -> const SubtitleGlyph*
+{
+    const Key key{fontId(font), index, qRound(outline * 4)};
+    auto it = m_glyphs.find(key);
+    if (it != m_glyphs.end())
+        return &*it;
+    SubtitleGlyph glyph;
+    auto path = font.pathForGlyph(index);
+    if (key.outline > 0) {
+        // pen of outline is centered on the contour, as QTextLayout does
+        QPainterPathStroker stroker;
+        stroker.setWidth(outline);
+        stroker.setJoinStyle(Qt::RoundJoin);
+        stroker.setCapStyle(Qt::RoundCap);
+        path.addPath(stroker.createStroke(path));
+        path.setFillRule(Qt::WindingFill);
+    }
+    const auto bound = path.boundingRect().toAlignedRect();
+    if (!bound.isEmpty()) {
+        const auto pos = allocate(bound.size());
+        if (pos.x() < 0)
+            return nullptr;
+        rasterize(path, bound, pos);
+        glyph.rect = {pos, bound.size()};
+        glyph.offset = bound.topLeft();
+    }
+    return &*m_glyphs.insert(key, glyph);
+}
+
+auto SubtitleGlyphAtlas::upload(OpenGLTexture2D *texture) -> void
+{
+    if (texture->size() != size()) {
+        const auto info = OpenGLTextureTransferInfo::get(OGL::OneComponent);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        texture->initialize(size(), info, m_data.constData());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    } else if (m_dirtyTop < m_dirtyBottom) {
+        // whole rows are contiguous in memory, so single call is enough
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        texture->upload(0, m_dirtyTop, m_size, m_dirtyBottom - m_dirtyTop,
+                        m_data.constData() + m_dirtyTop * m_size);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    m_dirtyTop = m_size;
+    m_dirtyBottom = 0;
+}
+
+auto SubtitleGlyphAtlas::toImage() const -> QImage
+{
+    QImage image(size(), QImage::Format_Indexed8);
+    QVector<QRgb> table(256);
+    for (int i = 0; i < 256; ++i)
+        table[i] = qRgb(i, i, i);
+    image.setColorTable(table);
+    for (int y = 0; y < m_size; ++y)
+        memcpy(image.scanLine(y), m_data.constData() + y * m_size, m_size);
+    return image;
+}
@@ -0,0 +1,48 @@
+#ifndef SUBTITLEGLYPHATLAS_HPP
+#define SUBTITLEGLYPHATLAS_HPP
+
+#include <QRawFont>
+
+class OpenGLTexture2D;
+
+struct SubtitleGlyph {
+    QRect rect; // in atlas, empty for blank glyph
+    QPoint offset; // of top-left corner from pen position
+};
+
+// persistent alpha mask atlas of rasterized glyphs with optional outline
+class SubtitleGlyphAtlas {
+public:
+    SubtitleGlyphAtlas(int size = 1024);
+    // returns nullptr if atlas has no room for the glyph
+    auto glyph(const QRawFont &font, quint32 index,
+               double outline = 0.0) -> const SubtitleGlyph*;
+    // opaque block for underline and strike out
+    auto solid() const -> QRectF { return {1.5, 1.5, 1.0, 1.0}; }
+    auto size() const -> QSize { return {m_size, m_size}; }
+    auto count() const -> int { return m_glyphs.size(); }
+    auto clear() -> void;
+    // initializes or updates modified rows of texture which should be bound
+    auto upload(OpenGLTexture2D *texture) -> void;
+    auto toImage() const -> QImage;
+private:
+    struct Key {
+        int font; quint32 index; int outline;
+        DECL_EQ(Key, &T::font, &T::index, &T::outline)
+    };
+    friend auto qHash(const Key &key, uint seed) -> uint
+        { return qHash(key.font, seed) ^ qHash(key.index, ~seed) ^ key.outline; }
+    struct Shelf { int y, height, x; };
+    auto fontId(const QRawFont &font) -> int;
+    auto allocate(const QSize &size) -> QPoint;
+    auto rasterize(const QPainterPath &path, const QRect &bound,
+                   const QPoint &pos) -> void;
+    int m_size = 0, m_bottom = 0, m_dirtyTop = 0, m_dirtyBottom = 0;
+    QVector<uchar> m_data;
+    QVector<Shelf> m_shelves;
+    QHash<QString, int> m_fonts;
+    QHash<Key, SubtitleGlyph> m_glyphs;
+    QImage m_scratch;
+};
+
+#endif // SUBTITLEGLYPHATLAS_HPP
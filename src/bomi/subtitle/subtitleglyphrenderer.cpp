@@ -0,0 +1,354 @@
+#include "subtitleglyphrenderer.hpp"
+#include "subtitleglyphatlas.hpp"
+#include "subtitledrawer.hpp"
+#include "opengl/openglframebufferobject.hpp"
+#include "opengl/opengltexturebinder.hpp"
+#include "opengl/opengloffscreencontext.hpp"
+#include "misc/log.hpp"
+#include <QOpenGLBuffer>
+#include <QElapsedTimer>
+
+DECLARE_LOG_CONTEXT(Subtitle)
+
+enum Attr {AttrPosition, AttrTexCoord, AttrColor};
+using Vertex = OGL::TextureColorVertex;
+using Caption = SubtitleGlyphRenderer::Caption;
+
+struct SubtitleGlyphRenderer::Data {
+    SubtitleGlyphAtlas atlas;
+    OpenGLTexture2D texture;
+    QOpenGLShaderProgram *shader = nullptr;
+    QOpenGLBuffer vbo{QOpenGLBuffer::VertexBuffer};
+    int vboSize = 0, loc_atlas = -1, loc_matrix = -1;
+    QVector<Vertex> vertices;
+
+    auto build() -> void
+    {
+        if (shader)
+            return;
+        shader = new QOpenGLShaderProgram;
+        shader->addShaderFromSourceCode(QOpenGLShader::Fragment, R"(
+            uniform sampler2D atlas;
+            varying vec4 c;
+            varying vec2 texCoord;
+            void main() {
+                float a = c.a*texture2D(atlas, texCoord).r;
+                gl_FragColor = vec4(c.rgb*a, a);
+            }
+        )");
+        shader->addShaderFromSourceCode(QOpenGLShader::Vertex, R"(
+            uniform mat4 matrix;
+            varying vec4 c;
+            varying vec2 texCoord;
+            attribute vec4 aPosition;
+            attribute vec2 aTexCoord;
+            attribute vec4 aColor;
+            void main() {
+                c = aColor;
+                texCoord = aTexCoord;
+                gl_Position = matrix*aPosition;
+            }
+        )");
+        shader->bindAttributeLocation("aPosition", AttrPosition);
+        shader->bindAttributeLocation("aTexCoord", AttrTexCoord);
+        shader->bindAttributeLocation("aColor", AttrColor);
+        shader->link();
+        Q_ASSERT(shader->isLinked());
+        loc_atlas = shader->uniformLocation("atlas");
+        loc_matrix = shader->uniformLocation("matrix");
+        shader->bind();
+        shader->setUniformValue(loc_atlas, 0);
+        shader->release();
+    }
+
+    auto quad(QVector<Vertex> &vertices, const QRectF &pos, QRectF tex,
+              const QColor &color) -> void
+    {
+        const double w = atlas.size().width(), h = atlas.size().height();
+        tex = {tex.x()/w, tex.y()/h, tex.width()/w, tex.height()/h};
+        const int size = vertices.size();
+        vertices.resize(size + 6);
+        OGL::CoordAttr::fillTriangles(vertices.begin() + size,
+            &Vertex::position, pos.topLeft(), pos.bottomRight(),
+            &Vertex::texCoord, tex.topLeft(), tex.bottomRight(),
+            [&] (Vertex *it) { it->color.set(color); });
+    }
+
+    auto draw(const QSize &size) -> void
+    {
+        build();
+        OGL::func()->glActiveTexture(GL_TEXTURE0);
+        OpenGLTextureBinder<OGL::Target2D> binder(&texture);
+        atlas.upload(&texture);
+
+        vbo.bind();
+        const int bytes = vertices.size()*sizeof(Vertex);
+        if (vboSize < bytes)
+            vbo.allocate(vertices.constData(), vboSize = bytes);
+        else
+            vbo.write(0, vertices.constData(), bytes);
+
+        QMatrix4x4 matrix;
+        matrix.ortho(0, size.width(), 0, size.height(), -1, 1);
+        shader->bind();
+        SET_ATTR_COORD(shader, AttrPosition, Vertex, position);
+        SET_ATTR_COORD(shader, AttrTexCoord, Vertex, texCoord);
+        SET_ATTR_COLOR(shader, AttrColor, Vertex, color);
+        shader->enableAttributeArray(AttrPosition);
+        shader->enableAttributeArray(AttrTexCoord);
+        shader->enableAttributeArray(AttrColor);
+        shader->setUniformValue(loc_matrix, matrix);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+        glDisable(GL_BLEND);
+        shader->disableAttributeArray(AttrPosition);
+        shader->disableAttributeArray(AttrTexCoord);
+        shader->disableAttributeArray(AttrColor);
+        shader->release();
+        vbo.release();
+    }
+
+    // returns false if atlas has been exhausted
+    auto layout(Caption &caption, const SubtitleDrawer &drawer,
+                const RichTextDocument &text, const QRectF &area,
+                double dpr) -> bool
+    {
+        if (!text.hasWords())
+            return true;
+        const auto &style = drawer.style();
+        const auto &doc = drawer.layout(text, area);
+        const double scale = drawer.scale(area)*dpr;
+        const double fscale = style.font.height()*scale;
+
+        // same geometry as SubtitleDrawer::draw() except for blur
+        QPoint thick(0, 0), soffset(0, 0), offset(0, 0);
+        if (style.bbox.enabled)
+            thick = (fscale*style.bbox.padding).toPoint();
+        if (style.shadow.enabled)
+            soffset = (fscale*style.shadow.offset).toPoint();
+        QPoint pad = soffset;
+        if (soffset.x() < 0) {
+            pad.rx() = offset.rx() = -soffset.x();
+            soffset.rx() = 0;
+        }
+        if (soffset.y() < 0) {
+            pad.ry() = offset.ry() = -soffset.y();
+            soffset.ry() = 0;
+        }
+        offset += thick;
+        const auto nsize = doc.naturalSize()*scale;
+        caption.size = QSize(nsize.width() + 1, nsize.height() + 1)
+                + QSize(pad.x() + thick.x()*2, pad.y() + thick.y()*2);
+        const QPointF origin(-(area.width()*dpr - nsize.width())*0.5
+                             + offset.x(), offset.y());
+
+        struct Layer { QPoint shift; double outline; QColor color; };
+        QVector<Layer> layers;
+        const double outline = style.outline.enabled
+                ? style.font.height()*style.outline.width*2.0*scale : 0.0;
+        if (style.shadow.enabled)
+            layers.push_back({soffset, outline, style.shadow.color});
+        if (style.outline.enabled)
+            layers.push_back({{0, 0}, outline, style.outline.color});
+        layers.push_back({{0, 0}, 0.0, QColor()});
+
+        const auto runs = doc.glyphRuns();
+        for (auto &layer : layers) {
+            for (auto &run : runs) {
+                const auto &color = layer.color.isValid() ? layer.color
+                                                          : run.color;
+                auto font = run.glyphs.rawFont();
+                // quantize size to share glyphs between close scales
+                font.setPixelSize(qRound(font.pixelSize()*scale*4)/4.0);
+                const auto indexes = run.glyphs.glyphIndexes();
+                const auto positions = run.glyphs.positions();
+                for (int i = 0; i < indexes.size(); ++i) {
+                    const auto glyph = atlas.glyph(font, indexes[i],
+                                                   layer.outline);
+                    if (!glyph)
+                        return false;
+                    if (glyph->rect.isEmpty())
+                        continue;
+                    const auto pen = origin + positions[i]*scale + layer.shift;
+                    const QPoint aligned(qRound(pen.x()), qRound(pen.y()));
+                    quad(caption.vertices,
+                         QRectF(aligned + glyph->offset, glyph->rect.size()),
+                         glyph->rect, color);
+                }
+                if (positions.isEmpty())
+                    continue;
+                const auto &g = run.glyphs;
+                if (!g.underline() && !g.overline() && !g.strikeOut())
+                    continue;
+                const auto br = g.boundingRect();
+                const double baseline = origin.y() + positions[0].y()*scale
+                        + layer.shift.y();
+                const double t = qMax(1.0, font.lineThickness()), o = layer.outline;
+                auto line = [&] (double y) {
+                    const QRectF rect(origin.x() + br.left()*scale
+                                      + layer.shift.x() - o*0.5,
+                                      y - (t + o)*0.5, br.width()*scale + o, t + o);
+                    quad(caption.vertices, rect, atlas.solid(), color);
+                };
+                if (g.underline())
+                    line(baseline + font.underlinePosition());
+                if (g.overline())
+                    line(baseline - font.ascent());
+                if (g.strikeOut())
+                    line(baseline - font.ascent()/3.0);
+            }
+        }
+        if (style.bbox.enabled) {
+            caption.boundingBoxes = doc.boundingBoxes();
+            for (auto &bbox : caption.boundingBoxes) {
+                bbox.setTopLeft(bbox.topLeft() * scale + origin - thick);
+                bbox.setBottomRight(bbox.bottomRight() * scale + origin + thick);
+            }
+        }
+        return true;
+    }
+};
+
+SubtitleGlyphRenderer::SubtitleGlyphRenderer()
+    : d(new Data)
+{
+}
+
+SubtitleGlyphRenderer::~SubtitleGlyphRenderer()
+{
+    delete d;
+}
+
+auto SubtitleGlyphRenderer::initialize() -> void
+{
+    d->texture.create(OGL::Linear, OGL::ClampToEdge);
+    d->vbo.create();
+    d->vbo.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    d->vboSize = 0;
+}
+
+auto SubtitleGlyphRenderer::finalize() -> void
+{
+    d->texture.destroy();
+    d->vbo.destroy();
+    _Delete(d->shader);
+}
+
+auto SubtitleGlyphRenderer::atlas() const -> const SubtitleGlyphAtlas&
+{
+    return d->atlas;
+}
+
+auto SubtitleGlyphRenderer::prepare(const SubtitleDrawer &drawer,
+                                    const QList<RichTextDocument> &texts,
+                                    const QRectF &area, double dpr, bool *ok)
+-> QVector<Caption>
+{
+    QVector<Caption> captions(texts.size());
+    bool full = false;
+    for (int retry = 0; retry < 2; ++retry) {
+        full = false;
+        for (int i = 0; i < texts.size() && !full; ++i) {
+            captions[i] = Caption();
+            full = !d->layout(captions[i], drawer, texts[i], area, dpr);
+        }
+        if (!full)
+            break;
+        // glyphs for captions on screen are rasterized again
+        _Debug("Glyph atlas is full with %% glyphs.", d->atlas.count());
+        d->atlas.clear();
+    }
+    if (full)
+        captions.clear();
+    if (ok)
+        *ok = !full;
+    return captions;
+}
+
+auto SubtitleGlyphRenderer::render(OpenGLFramebufferObject *fbo,
+                                   const QVector<Caption> &captions) -> void
+{
+    if (!fbo || !fbo->isValid())
+        return;
+    d->vertices.clear();
+    for (auto &caption : captions) {
+        for (auto v : caption.vertices) {
+            v.position.set(v.position.toPoint() + caption.pos);
+            d->vertices.push_back(v);
+        }
+    }
+
+    // called inside scene graph which keeps its own target
+    GLint viewport[4] = {0, 0, 0, 0}, binding = 0;
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &binding);
+
+    fbo->bind();
+    glViewport(0, 0, fbo->width(), fbo->height());
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    if (!d->vertices.isEmpty())
+        d->draw(fbo->size());
+    OGL::func()->glBindFramebuffer(GL_FRAMEBUFFER, binding);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+auto SubtitleGlyphRenderer::benchmark() -> void
+{
+    OpenGLOffscreenContext gl;
+    gl.createSurface();
+    if (!gl.createContext() || !gl.makeCurrent()) {
+        _Error("Cannot create offscreen OpenGL context.");
+        return;
+    }
+    const QList<QSizeF> areas = { {1280, 720}, {1920, 1080}, {3840, 2160} };
+    QList<RichTextDocument> texts;
+    for (int i = 0; i < 50; ++i) {
+        RichTextDocument text;
+        text.setText(u"<p>Caption number %1: The quick brown fox"_q.arg(i)
+                     % u"<br>jumps over the lazy dog.</p>"_q);
+        texts.push_back(text);
+    }
+    SubtitleDrawer drawer;
+    drawer.setAlignment(Qt::AlignBottom | Qt::AlignHCenter);
+    drawer.setStyle(OsdStyle());
+    SubtitleGlyphRenderer renderer;
+    renderer.initialize();
+    OpenGLTexture2D texture;
+    texture.create();
+    for (auto &area : areas) {
+        qint64 image = 0, glyph = 0;
+        QElapsedTimer timer;
+        for (auto &text : texts) {
+            QImage sub; int gap = 0;
+            timer.start();
+            drawer.draw(sub, gap, text, {{0, 0}, area});
+            if (!sub.isNull()) {
+                OpenGLTextureBinder<OGL::Target2D> binder(&texture);
+                texture.initialize(sub.size(), sub.bits());
+            }
+            glFinish();
+            image += timer.nsecsElapsed();
+        }
+        OpenGLFramebufferObject *fbo = nullptr;
+        for (auto &text : texts) {
+            timer.start();
+            auto captions = renderer.prepare(drawer, { text }, {{0, 0}, area}, 1.0);
+            if (captions.isEmpty())
+                continue;
+            if (!fbo || fbo->size() != captions[0].size)
+                _Renew(fbo, captions[0].size.expandedTo({1, 1}));
+            renderer.render(fbo, captions);
+            glFinish();
+            glyph += timer.nsecsElapsed();
+        }
+        _Info("caption for %%: image %%us, glyph %%us with %% glyphs", area,
+              image / texts.size() / 1000.0, glyph / texts.size() / 1000.0,
+              renderer.atlas().count());
+        _Delete(fbo);
+    }
+    texture.destroy();
+    renderer.finalize();
+    gl.doneCurrent();
+}
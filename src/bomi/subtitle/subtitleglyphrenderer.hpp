@@ -0,0 +1,40 @@
+#ifndef SUBTITLEGLYPHRENDERER_HPP
+#define SUBTITLEGLYPHRENDERER_HPP
+
+#include "opengl/openglvertex.hpp"
+
+class SubtitleDrawer;                   class RichTextDocument;
+class SubtitleGlyphAtlas;               class OpenGLFramebufferObject;
+
+// draws captions as textured quads of glyphs from persistent atlas
+// instead of rasterizing whole caption image
+class SubtitleGlyphRenderer {
+public:
+    struct Caption {
+        QPoint pos = {0, 0}; // in target framebuffer, set by caller
+        QSize size = {0, 0}; // in device pixels
+        QVector<QRectF> boundingBoxes;
+        QVector<OGL::TextureColorVertex> vertices;
+    };
+    SubtitleGlyphRenderer();
+    ~SubtitleGlyphRenderer();
+    // requires current OpenGL context
+    auto initialize() -> void;
+    auto finalize() -> void;
+    // lays out texts and builds quads, rasterizing new glyphs into atlas
+    // ok is set to false if glyphs don't fit in atlas even after clearing it
+    auto prepare(const SubtitleDrawer &drawer, const QList<RichTextDocument> &texts,
+                 const QRectF &area, double dpr,
+                 bool *ok = nullptr) -> QVector<Caption>;
+    // restores framebuffer binding and viewport of caller
+    auto render(OpenGLFramebufferObject *fbo,
+                const QVector<Caption> &captions) -> void;
+    auto atlas() const -> const SubtitleGlyphAtlas&;
+    // compares with image backend in offscreen context
+    static auto benchmark() -> void;
+private:
+    struct Data;
+    Data *d;
+};
+
+#endif // SUBTITLEGLYPHRENDERER_HPP
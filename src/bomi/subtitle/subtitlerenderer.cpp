@@ -1,9 +1,17 @@
 #include "subtitlerenderer.hpp"
 #include "subtitlerenderingthread.hpp"
+#include "subtitleglyphrenderer.hpp"
 #include "misc/dataevent.hpp"
 #include "enum/autoselectmode.hpp"
 #include "opengl/opengltexture2d.hpp"
 #include "opengl/opengltexturebinder.hpp"
+#include "opengl/openglframebufferobject.hpp"
+#include "misc/log.hpp"
+
+DECLARE_LOG_CONTEXT(Subtitle)
+
+// glyphs didn't fit in atlas, so captions are drawn as images
+static constexpr int GlyphAtlasFull = QEvent::User + 2;
 
 struct SubtitleShaderData : public SubtitleRenderer::ShaderData {
     const OpenGLTexture2D *texture, *bbox;
@@ -62,7 +70,8 @@ struct SubtitleRenderer::Data {
     SubtitleDrawer drawer;
     int delay = 0, msec = 0, lastTime = -1;
     bool selecting = false, textChanged = true;
-    bool top = false, hidden = false, empty = true;
+    bool top = false, hidden = false, empty = true, glyphs = false;
+    bool fallback = false; // to images while glyph rendering is on
     double pos = 1.0;
     QMap<QString, int> langMap;
     QMutex mutex;
@@ -75,6 +84,8 @@ struct SubtitleRenderer::Data {
     QVector<quint32> zeros, bboxData;
     SubCompSelection selection{p};
     OpenGLTexture2D bbox;
+    SubtitleGlyphRenderer glyph;
+    OpenGLFramebufferObject *fbo = nullptr;
 
     auto find(int id) const -> SubComp*
     {
@@ -87,6 +98,8 @@ struct SubtitleRenderer::Data {
 
     double fps() const { return selection.fps(); }
     void updateDrawer() {
+        auto drawer = this->drawer;
+        drawer.setRasterizing(!glyphs || fallback);
         selection.setDrawer(drawer);
         p->reserve(UpdateGeometry);
     }
@@ -156,11 +169,14 @@ auto SubtitleRenderer::initializeGL() -> void
     SimpleTextureItem::initializeGL();
     texture().create();
     d->bbox.create();
+    d->glyph.initialize();
 }
 
 auto SubtitleRenderer::finalizeGL() -> void
 {
     SimpleTextureItem::finalizeGL();
+    _Delete(d->fbo);
+    d->glyph.finalize();
     d->bbox.destroy();
     texture().destroy();
 }
@@ -261,6 +277,14 @@ auto SubtitleRenderer::style() const -> const OsdStyle&
 
 auto SubtitleRenderer::unload() -> void
 {
+    // counters are per loaded subtitles for tuning budget and prefetch window
+    const auto stats = d->selection.cacheStats();
+    if (stats.hits + stats.misses > 0)
+        _Info("Caption cache: %% hits, %% misses, %% prefetched, "
+              "hit ratio %%, %%/%% KiB in use", stats.hits, stats.misses,
+              stats.prefetched, QString::number(stats.hitRatio(), 'f', 3),
+              stats.bytes >> 10, stats.budget >> 10);
+    d->selection.resetCacheStats();
     d->selection.clear();
     qDeleteAll(d->loaded);
     d->loaded.clear();
@@ -295,6 +319,10 @@ auto SubtitleRenderer::updateData(ShaderData *sd) -> void
 
 auto SubtitleRenderer::updateTexture(OpenGLTexture2D *texture) -> void
 {
+    if (d->glyphs && !d->fallback) {
+        updateGlyphs(texture);
+        return;
+    }
     d->imageSize = {0, 0};
     const int spacing = d->drawer.style().font.height()
             * d->drawer.scale(geometry())
@@ -338,6 +366,63 @@ auto SubtitleRenderer::updateTexture(OpenGLTexture2D *texture) -> void
         emit updated(d->lastTime);
 }
 
+auto SubtitleRenderer::updateGlyphs(OpenGLTexture2D *texture) -> void
+{
+    d->imageSize = {0, 0};
+    const int spacing = d->drawer.style().font.height()
+            * d->drawer.scale(geometry())
+            * d->drawer.style().spacing.paragraph + 0.5;
+    int lastTime = -1;
+    QList<RichTextDocument> texts;
+    d->selection.forImages([&] (const SubCompImage &image) {
+        texts.push_back(image.text());
+        if (image.isValid())
+            lastTime = std::max(image.iterator().key(), lastTime);
+    });
+    bool ok = true;
+    auto captions = d->glyph.prepare(d->drawer, texts, rect(),
+                                     devicePixelRatio(), &ok);
+    if (!ok) {
+        _Warn("Too many glyphs for atlas. Fall back to caption images.");
+        d->fallback = true;
+        _PostEvent(this, GlyphAtlasFull);
+    }
+    for (auto &caption : captions) {
+        if (d->imageSize.width() < caption.size.width())
+            d->imageSize.rwidth() = caption.size.width();
+        d->imageSize.rheight() += caption.size.height() + spacing;
+    }
+    d->imageSize.rheight() -= spacing;
+    if (!d->imageSize.isEmpty()) {
+        OpenGLTextureBinder<OGL::Target2D> binder;
+        if (texture->size() != d->imageSize || !d->fbo) {
+            binder.bind(texture);
+            texture->initialize(d->imageSize);
+            _Renew(d->fbo, *texture);
+        }
+        const auto len = d->imageSize.width()*d->imageSize.height();
+        _Expand(d->zeros, len);
+        binder.bind(&d->bbox);
+        d->bbox.initialize(d->imageSize, d->zeros.data());
+        int y = 0;
+        for (auto &caption : captions) {
+            const int x = (d->imageSize.width() - caption.size.width())*0.5;
+            caption.pos = {x, y};
+            for (auto &bbox : caption.boundingBoxes) {
+                const auto rect = bbox.toRect().translated(x, y);
+                if (_Expand(d->bboxData, rect.width()*rect.height()))
+                    d->bboxData.fill(_Max<quint32>());
+                d->bbox.upload(rect, d->bboxData.data());
+            }
+            y += caption.size.height() + spacing;
+        }
+        d->glyph.render(d->fbo, captions);
+        reserve(UpdateGeometry, false);
+    }
+    if (_Change(d->lastTime, lastTime))
+        emit updated(d->lastTime);
+}
+
 auto SubtitleRenderer::afterUpdate() -> void
 {
     d->updateVisible();
@@ -455,6 +540,36 @@ auto SubtitleRenderer::lastUpdatedTime() const -> int
     return d->lastTime;
 }
 
+auto SubtitleRenderer::cacheStats() const -> SubCompImageCacheStats
+{
+    return d->selection.cacheStats();
+}
+
+auto SubtitleRenderer::setCacheBudget(qint64 bytes) -> void
+{
+    d->selection.setCacheBudget(bytes);
+}
+
+auto SubtitleRenderer::setPrefetchWindow(int before, int after) -> void
+{
+    d->selection.setPrefetchWindow(before, after);
+}
+
+auto SubtitleRenderer::setGlyphRendering(bool on) -> void
+{
+    // retry glyphs which might fit in atlas now
+    const bool retry = _Change(d->fallback, false);
+    if (_Change(d->glyphs, on) || retry) {
+        d->updateDrawer();
+        rerender();
+    }
+}
+
+auto SubtitleRenderer::isGlyphRendering() const -> bool
+{
+    return d->glyphs;
+}
+
 auto SubtitleRenderer::start(int time) const -> int
 {
     int ret = -1;
@@ -578,6 +693,9 @@ auto SubtitleRenderer::customEvent(QEvent *event) -> void
         if (d->selection.update(_GetData<SubCompImage>(event)))
             d->textChanged = true;
         reserve(UpdateMaterial);
+    } else if (event->type() == GlyphAtlasFull) {
+        d->updateDrawer();
+        rerender();
     }
 }
 
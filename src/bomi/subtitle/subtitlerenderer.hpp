@@ -7,7 +7,7 @@
 class SubComp;                          class Subtitle;
 class RichTextDocument;
 struct OsdStyle;                        class SubtitleDrawer;
-enum class AutoselectMode;
+enum class AutoselectMode;              struct SubCompImageCacheStats;
 
 class SubtitleRenderer : public SimpleTextureItem  {
     Q_OBJECT
@@ -47,6 +47,12 @@ public:
     auto setFPS(double fps) -> void;
     auto toTrackList() const -> StreamList;
     auto lastUpdatedTime() const -> int;
+    auto cacheStats() const -> SubCompImageCacheStats;
+    auto setCacheBudget(qint64 bytes) -> void;
+    auto setPrefetchWindow(int before, int after) -> void;
+    // draw glyphs from atlas on GPU instead of uploading caption images
+    auto setGlyphRendering(bool on) -> void;
+    auto isGlyphRendering() const -> bool;
 //    auto load(const QVector<StreamTrack> &tracks) -> void;
 signals:
     void updated(int time);
@@ -64,6 +70,7 @@ private:
     auto updateTexture(OpenGLTexture2D *texture) -> void override;
     auto updateData(ShaderData *data) -> void override;
     auto updateVertex(Vertex *vertex) -> void override;
+    auto updateGlyphs(OpenGLTexture2D *texture) -> void;
     struct Data; Data *d;
     friend class SubtitleRendererShader;
 };
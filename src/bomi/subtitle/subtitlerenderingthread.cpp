@@ -1,31 +1,56 @@
 #include "subtitlerenderingthread.hpp"
 #include "misc/dataevent.hpp"
+#include "misc/trace.hpp"
 
-template<>
-inline bool qMapLessThanKey(const SubCompItMapIt &lhs,
-                            const SubCompItMapIt &rhs) {
-    return lhs.key() < rhs.key();
-}
+struct SubCompSelection::Data {
+    QMutex mutex;
+    QWaitCondition wait;
+    QObject *renderer = nullptr;
+    SubtitleDrawer drawer;
+    QRectF rect;
+    double dpr = 1.0, fps = 30.0;
+    // captions in [time - before, time + after] in msec are prerendered
+    int before = 3000, after = 10000;
+    SubCompImageCache cache;
+};
 
 struct SubCompSelection::Thread::Data {
+    Thread *p = nullptr;
     Item *item = nullptr;
-    int time = 0;
+    int time = 0, before = 0, after = 0;
     const SubComp *comp = nullptr;
-    SubCompItMap its;
-    SubCompItMapIt it = its.end();
-    QMap<SubCompItMapIt, SubCompImage> pool;
+    int it = -1; // index of caption in comp
+    SubCompImageCache *cache = nullptr;
+    quint64 option = 0;
     QObject *receiver = nullptr;
-    bool quit = false;
+    bool quit = false, prefetched = true;
     double fps = 1.0, dpr = 1.0, mul = 1.0;
     QMutex *mutex; QWaitCondition *wait;
     QRectF rect; SubtitleDrawer drawer;
     SubCompSelection *selection = nullptr;
 
-    SubComp::ConstIt iterator(int time) const { return comp->start(time, fps); }
-    auto newPicture(SubCompItMapIt it)
+    auto key(int it) const -> SubCompImageCache::Key
+    {
+        SubCompImageCache::Key key;
+        key.comp = comp;
+        key.caption = comp->key(it);
+        key.option = option;
+        return key;
+    }
+    auto newPicture(int it) -> SubCompImage
     {
-        auto pic = pool.insert(it, SubCompImage(comp, *it, item));
-        drawer.draw(*pic, rect, dpr);
+        SubCompImage pic(comp, comp->begin() + it, item);
+        drawer.draw(pic, rect, dpr);
+        return pic;
+    }
+    auto picture(int it) -> SubCompImage
+    {
+        const auto key = this->key(it);
+        SubCompImage pic(nullptr);
+        if (!cache->find(key, &pic)) {
+            pic = newPicture(it);
+            cache->insert(key, pic);
+        }
         return pic;
     }
     auto update()
@@ -34,56 +59,65 @@ struct SubCompSelection::Thread::Data {
             return;
         auto post = [this] (const SubCompImage &pic)
             { _PostEvent(receiver, ImagePrepared, pic); };
-        if (it != its.end()) {
-            auto cache = pool.find(it);
-            if (cache == pool.end())
-                cache = newPicture(it);
-            post(*cache);
-        } else
+        if (it >= 0)
+            post(picture(it));
+        else
             post(comp);
     }
+    auto interrupted() const -> bool
+    {
+        if (quit)
+            return true;
+        QMutexLocker locker(mutex);
+        return p->flags != 0;
+    }
+    // returns false if interrupted by new request
+    auto prefetch(int it) -> bool
+    {
+        if (interrupted())
+            return false;
+        const auto key = this->key(it);
+        if (!cache->contains(key))
+            cache->insert(key, newPicture(it), true);
+        return true;
+    }
 
     auto fillCache()
     {
-        if (it == its.end())
+        prefetched = true;
+        if (it < 0)
             return;
-        auto iit = pool.begin();
-        while (iit != pool.end() && iit.key().key() < it.key())
-            iit = pool.erase(iit);
-        Q_ASSERT(iit.key() == it);
-        auto key = it;
-        const int size = qMin(2, pool.size()+1);
-        for (int i=0; i<size; ++i) {
-            ++iit; ++key;
-            if (key == its.end())
+        // following captions have priority and at least two are prepared
+        for (int next = it + 1, count = 0; next < comp->size(); ++next, ++count) {
+            if (count >= 2 && comp->toTime(comp->key(next), fps) > time + after)
                 break;
-            if (iit == pool.end())
-                iit = newPicture(key);
+            if (!(prefetched = prefetch(next)))
+                return;
+        }
+        for (int prev = it - 1; prev >= 0; --prev) {
+            if (comp->toTime(comp->key(prev), fps) < time - before)
+                break;
+            if (!(prefetched = prefetch(prev)))
+                return;
         }
     }
 
     auto draw(bool force)
     {
-        auto iit = --its.upperBound(time);
+        const int iit = comp->find(time, fps);
         if (force || it != iit) {
-            if (it == its.end() || ++it != iit) {
-                pool.clear();
-                it = iit;
-                update();
-            } else {
-                update();
-                fillCache();
-            }
+            it = iit;
+            update();
+            prefetched = false;
         }
+        if (!prefetched)
+            fillCache();
     }
 
     auto rebuild()
     {
-        pool.clear();
-        its.clear();
-        it = its.end();
-        for (auto iit = comp->begin(); iit != comp->end(); ++iit)
-            its.insert(comp->toTime(iit.key(), fps), iit);
+        // keys are converted with new fps on lookup
+        it = -1;
     }
 };
 
@@ -93,12 +127,14 @@ SubCompSelection::Thread::Thread(QMutex *mutex, QWaitCondition *wait,
     : QThread()
     , d(new Data)
 {
+    d->p = this;
     d->item = item;
     d->comp = item->comp;
     d->receiver = renderer;
     d->mutex = mutex;
     d->wait = wait;
     d->selection = selection;
+    d->cache = &selection->d->cache;
 }
 
 SubCompSelection::Thread::~Thread()
@@ -128,7 +164,7 @@ auto SubCompSelection::Thread::run() -> void
     int flags = 0;
     while (!d->quit) {
         QMutexLocker locker(d->mutex);
-        if (!(this->flags & ForceUpdate))
+        if (!(this->flags & (ForceUpdate | NewWindow)) && d->prefetched)
             d->wait->wait(d->mutex);
         if (d->quit)
             break;
@@ -136,6 +172,11 @@ auto SubCompSelection::Thread::run() -> void
         this->flags = 0;
         d->time = time;
         d->fps = fps;
+        if (flags & NewWindow) {
+            d->before = before;
+            d->after = after;
+            d->prefetched = false;
+        }
         if (flags & NewOption) {
             if (flags & NewDrawer)
                 d->drawer = drawer;
@@ -147,28 +188,24 @@ auto SubCompSelection::Thread::run() -> void
         locker.unlock();
         if (d->quit)
             break;
-        if (flags & Rebuild)
+        if (flags & Rebuild) {
+            TraceScope trace("sub rebuild");
             d->rebuild();
+        }
         if (flags & NewOption)
-            d->pool.clear();
+            d->option = d->drawer.cacheKey(d->rect, d->dpr);
         if (d->quit)
             break;
-        if (d->time > 0 && d->fps > 0.0 && !d->its.isEmpty())
+        if (d->time > 0 && d->fps > 0.0 && !d->comp->isEmpty()) {
+            TraceScope trace("sub render", d->time);
             d->draw(flags & ForceUpdate);
+        } else
+            d->prefetched = true;
     }
 }
 
 /******************************************************************************/
 
-struct SubCompSelection::Data {
-    QMutex mutex;
-    QWaitCondition wait;
-    QObject *renderer = nullptr;
-    SubtitleDrawer drawer;
-    QRectF rect;
-    double dpr = 1.0, fps = 30.0;
-};
-
 SubCompSelection::SubCompSelection(QObject *renderer)
     : d(new Data)
 {
@@ -186,6 +223,7 @@ auto SubCompSelection::remove(const SubComp *comp) -> void
     if (it != items.end()) {
         it->release();
         items.erase(it);
+        d->cache.remove(comp);
     }
 }
 
@@ -209,6 +247,7 @@ auto SubCompSelection::clear() -> void
     for (auto &item : items)
         item.release();
     items.clear();
+    d->cache.clear();
 }
 
 auto SubCompSelection::setArea(const QRectF &rect, double dpr) -> void
@@ -239,6 +278,7 @@ auto SubCompSelection::prepend(const SubComp *comp) -> bool
     item.thread->setFPS(d->fps);
     item.thread->setDrawer(d->drawer);
     item.thread->setArea(d->rect, d->dpr);
+    item.thread->setPrefetchWindow(d->before, d->after);
     item.thread->start();
     return true;
 }
@@ -271,3 +311,26 @@ auto SubCompSelection::setMargin(double top, double bottom,
     margin.right = right; margin.left = left;
     d->drawer.setMargin(margin);
 }
+
+auto SubCompSelection::cacheStats() const -> SubCompImageCache::Stats
+{
+    return d->cache.stats();
+}
+
+auto SubCompSelection::resetCacheStats() -> void
+{
+    d->cache.resetStats();
+}
+
+auto SubCompSelection::setCacheBudget(qint64 bytes) -> void
+{
+    d->cache.setBudget(bytes);
+}
+
+auto SubCompSelection::setPrefetchWindow(int before, int after) -> void
+{
+    if (d->before == before && d->after == after)
+        return;
+    d->before = before; d->after = after;
+    forThreads([=] (Thread *t) { t->setPrefetchWindow(before, after); });
+}
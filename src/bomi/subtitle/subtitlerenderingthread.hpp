@@ -1,16 +1,14 @@
 #ifndef SUBTITLERENDERINGTHREAD_HPP
 #define SUBTITLERENDERINGTHREAD_HPP
 
-#include "subtitledrawer.hpp"
-
-using SubCompItMap = QMap<int, SubComp::ConstIt>;
-using SubCompItMapIt = SubCompItMap::const_iterator;
+#include "subcompimagecache.hpp"
 
 class SubCompSelection {
 public:
     static constexpr int ImagePrepared = QEvent::User+1;
     enum Flag {
-        NewDrawer = 1, NewArea = 2, Rebuild = 4, Rerender = 8, Tick = 16
+        NewDrawer = 1, NewArea = 2, Rebuild = 4, Rerender = 8, Tick = 16,
+        NewWindow = 32
     };
 private:
     struct Item;
@@ -23,13 +21,14 @@ private:
         auto render(int time, int flags) -> void;
         auto setArea(const QRectF &rect, double dpr) -> void;
         auto setDrawer(const SubtitleDrawer &drawer) -> void;
+        auto setPrefetchWindow(int before, int after) -> void;
         auto finish() -> void;
         auto run() -> void;
     private:
         QRectF rect;
         double dpr = 1.0, fps = 1.0;
         SubtitleDrawer drawer;
-        int time = 0, flags = 0;
+        int time = 0, flags = 0, before = 0, after = 0;
         struct Data; Data *d;
     };
     struct Item {
@@ -62,6 +61,11 @@ public:
     auto setFPS(double fps) -> void;
     auto setMargin(double top, double bottom,
                    double right, double left) -> void;
+    auto cacheStats() const -> SubCompImageCache::Stats;
+    auto resetCacheStats() -> void;
+    auto setCacheBudget(qint64 bytes) -> void;
+    // prerender captions in [time - before, time + after] in msec
+    auto setPrefetchWindow(int before, int after) -> void;
 private:
     auto item(const SubCompImage &image) -> Item*;
     auto find(const SubComp *comp) -> List::iterator;
@@ -85,6 +89,10 @@ inline auto SubCompSelection::Thread::setArea(const QRectF &rect,
 inline auto SubCompSelection::Thread::setDrawer(const SubtitleDrawer &d) -> void
 { this->drawer = d; flags |= NewDrawer; }
 
+inline auto SubCompSelection::Thread::setPrefetchWindow(int before,
+                                                        int after) -> void
+{ this->before = before; this->after = after; flags |= NewWindow; }
+
 template<class LessThan>
 inline auto SubCompSelection::sort(LessThan lt) -> void
 {
@@ -8,6 +8,7 @@
 #include "player/mpv_helper.hpp"
 #include "opengl/opengloffscreencontext.hpp"
 #include "os/os.hpp"
+#include "misc/trace.hpp"
 #include "enum/colorrange.hpp"
 #include "enum/colorspace.hpp"
 extern "C" {
@@ -339,6 +340,7 @@ auto VideoProcessor::hwdec() const -> QString
 
 auto VideoProcessor::filterIn(mp_image *_mpi) -> int
 {
+    TraceScope trace("vf filterIn");
     if (!_mpi) { // propagate eof
         d->passthrough.push(MpImage());
         d->deinterlacer.push(MpImage());
@@ -422,6 +424,7 @@ auto VideoProcessor::needsInput() const -> bool
 
 auto VideoProcessor::filterOut() -> int
 {
+    TraceScope trace("vf filterOut");
     if (!d->filter)
         return 0;
     auto mpi = std::move(d->filter->pop());